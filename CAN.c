@@ -1,153 +1,394 @@
 #include "can.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/eeprom.h>
 #include "can_lookup.h"
 #include "debug.h"
 #include "LED.h"
+#include "profiler.h"
+#include "cmd_monitor.h"
+#include "j1939.h"
+#include "can_error.h"
+#include "system_timer.h"
+#include "can_timing.h"
+#include "fault_inject.h"
+#include "cpu_load.h"
 
-static CAN_Message_t can_buffer[CAN_BUFFER_SIZE];
-static uint8_t buffer_head = 0;
-static uint8_t buffer_tail = 0;
-static uint8_t buffer_count = 0;
+#define CAN_RX_MOB 0       // Command PGN from the master
+#define CAN_TX_MOB 1
+#define CAN_REQUEST_MOB 2  // J1939 Request
+#define CAN_CLAIM_MOB 3    // J1939 Address Claimed
+#define CAN_RX_ENABLE ((1 << CONMOB1) | (1 << IDE))
+#define CAN_GENERAL_ERRORS ((1 << SERG) | (1 << CERG) | (1 << FERG) | (1 << AERG))
+
+CAN_TIMING_DEFINE(CAN_TIMING_125K, 125000);
+CAN_TIMING_DEFINE(CAN_TIMING_250K, 250000);
+CAN_TIMING_DEFINE(CAN_TIMING_500K, 500000);
+CAN_TIMING_DEFINE(CAN_TIMING_1M, 1000000);
+
+_Static_assert(CAN_BAUD_RATE == 125000 || CAN_BAUD_RATE == 250000 ||
+               CAN_BAUD_RATE == 500000 || CAN_BAUD_RATE == 1000000,
+               "CAN_BAUD_RATE must be one of the CAN_Baud_t rates");
+
+// CANBT1..3 per CAN_Baud_t
+static const uint8_t can_bit_timing[CAN_BAUD_COUNT][3] = {
+    CAN_TIMING_REGS(CAN_TIMING_125K),
+    CAN_TIMING_REGS(CAN_TIMING_250K),
+    CAN_TIMING_REGS(CAN_TIMING_500K),
+    CAN_TIMING_REGS(CAN_TIMING_1M),
+};
+
+static volatile CAN_Message_t can_buffer[CAN_BUFFER_SIZE];
+static volatile uint8_t buffer_head = 0;
+static volatile uint8_t buffer_tail = 0;
+static volatile uint8_t buffer_count = 0;
+
+static uint32_t cmd_id = CAN_MSG_ID;
+static uint8_t node_addr = CAN_DEFAULT_NODE_ADDR;
+static CAN_Baud_t baud = CAN_BAUD_DEFAULT;
+static volatile CAN_Stats_t can_stats;
+
+// Extended-ID reception on one MOb, only the bits set in mask are compared
+static void can_mob_receive(uint8_t mob, uint32_t id, uint32_t mask) {
+    CANPAGE = (mob << MOBNB0);
+    CANSTMOB = 0x00;
+    CANCDMOB = 0x00;
+    CANIDT1 = (uint8_t)(id >> 21);
+    CANIDT2 = (uint8_t)(id >> 13);
+    CANIDT3 = (uint8_t)(id >> 5);
+    CANIDT4 = (uint8_t)(id << 3);
+    CANIDM1 = (uint8_t)(mask >> 21);
+    CANIDM2 = (uint8_t)(mask >> 13);
+    CANIDM3 = (uint8_t)(mask >> 5);
+    CANIDM4 = (uint8_t)(mask << 3) | (1 << IDEMSK);
+    CANCDMOB = CAN_RX_ENABLE;
+}
+
+static uint32_t can_mob_read_id(void) {
+    return ((uint32_t)CANIDT1 << 21) |
+           ((uint32_t)CANIDT2 << 13) |
+           ((uint32_t)CANIDT3 << 5) |
+           ((uint32_t)CANIDT4 >> 3);
+}
+
+static void can_set_bit_timing(CAN_Baud_t index) {
+    CANBT1 = can_bit_timing[index][0];
+    CANBT2 = can_bit_timing[index][1];
+    CANBT3 = can_bit_timing[index][2];
+}
+
+#if CAN_AUTOBAUD_ENABLED
+// Try each bit rate in listen-only mode, so a wrong guess never puts error
+// frames on the bus. A rate locks after CAN_AUTOBAUD_LOCK_FRAMES frames
+// without a single error; a silent bus keeps the start rate. True on a lock,
+// *baud is then the detected rate.
+static bool can_autobaud(CAN_Baud_t *baud) {
+    CAN_Baud_t start = *baud;
+
+    for (uint8_t attempt = 0; attempt < CAN_AUTOBAUD_PASSES * CAN_BAUD_COUNT; attempt++) {
+        CAN_Baud_t index = (CAN_Baud_t)((start + attempt) % CAN_BAUD_COUNT);
+        uint8_t frames = 0;
+        bool error = false;
+
+        CANGCON = (1 << SWRES);
+        can_set_bit_timing(index);
+        can_mob_receive(CAN_RX_MOB, 0, 0);
+        CANGIT = CANGIT;  // Write-one-to-clear stale flags
+        CANGCON = (1 << LISTEN) | (1 << ENASTB);
+
+        uint32_t window_start = system_timer_get_ms();
+        while (!error && frames < CAN_AUTOBAUD_LOCK_FRAMES &&
+               (system_timer_get_ms() - window_start) < CAN_AUTOBAUD_WINDOW_MS) {
+            CANPAGE = (CAN_RX_MOB << MOBNB0);
+            if (CANSTMOB & (1 << RXOK)) {
+                frames++;
+                CANSTMOB = 0x00;
+                CANCDMOB = CAN_RX_ENABLE;
+            }
+            error = (CANGIT & CAN_GENERAL_ERRORS) != 0;
+        }
+
+        if (!error && frames >= CAN_AUTOBAUD_LOCK_FRAMES) {
+            *baud = index;
+            return true;
+        }
+    }
+
+    DEBUG_PRINTLN("CAN auto-baud: no lock, keeping stored rate");
+    return false;
+}
+#endif
 
 void CAN_init(void) {
+    // Per-node identity from EEPROM, erased cells keep the defaults
+    uint32_t stored_id = eeprom_read_dword((uint32_t*)EEPROM_CAN_ID);
+    uint8_t stored_addr = eeprom_read_byte((uint8_t*)EEPROM_NODE_ADDR);
+    uint8_t stored_baud = eeprom_read_byte((uint8_t*)EEPROM_CAN_BAUD);
+    if (stored_id != 0xFFFFFFFF) {
+        cmd_id = stored_id & 0x1FFFFFFF;
+    }
+    if (stored_addr != 0xFF) {
+        node_addr = stored_addr;
+    }
+    if (stored_baud < CAN_BAUD_COUNT) {
+        baud = (CAN_Baud_t)stored_baud;
+    }
+
+#if CAN_AUTOBAUD_ENABLED
+    // Only a locked rate is worth remembering, a silent bus leaves the cell
+    if (can_autobaud(&baud) && baud != stored_baud) {
+        eeprom_update_byte((uint8_t*)EEPROM_CAN_BAUD, baud);
+    }
+#endif
+
     // Reset CAN controller
     CANGCON |= (1 << SWRES);
-    
-    // Set baud rate (250kbps @ 16MHz)
-    CANBT1 = 0x06;
-    CANBT2 = 0x0C;
-    CANBT3 = 0x37;
-    
-    // Enable CAN interrupts
-    CANGIE = (1 << ENIT) | (1 << ENRX);
-    
-    // Configure MOb0 for reception
-    CANPAGE = 0x00;
+
+    can_set_bit_timing(baud);
+
+    // Enable CAN interrupts, bus-off and error frames feed can_error.c
+    CAN_error_init();
+    CANGIE = (1 << ENIT) | (1 << ENRX) | (1 << ENBOFF) | (1 << ENERG);
+
+    // Hardware filtering per PGN, unrelated bus traffic never interrupts
+    can_mob_receive(CAN_RX_MOB, cmd_id, J1939_MASK_PGN_SA);
+    can_mob_receive(CAN_REQUEST_MOB, J1939_make_id(0, J1939_PGN_REQUEST, 0, 0), J1939_MASK_PF);
+    can_mob_receive(CAN_CLAIM_MOB, J1939_make_id(0, J1939_PGN_ADDRESS_CLAIMED, 0, 0), J1939_MASK_PF);
+    CANIE2 = (1 << IEMOB0) | (1 << IEMOB2) | (1 << IEMOB3);
+
+    // MOb1 is used for status transmission, idle until CAN_send()
+    CANPAGE = (CAN_TX_MOB << MOBNB0);
+    CANSTMOB = 0x00;
     CANCDMOB = 0x00;
-    CANIDT1 = 0x00;
-    CANIDT2 = 0x00;
-    CANIDT3 = 0x00;
-    CANIDT4 = 0x00;
-    CANIDM1 = 0x00;
-    CANIDM2 = 0x00;
-    CANIDM3 = 0x00;
-    CANIDM4 = 0x00;
-    
-    // Enable reception mode for MOb0
-    CANCDMOB = (1 << CONMOB1);
-    CANIE2 = (1 << IEMOB0);
-    
+
     // Enable CAN controller
     CANGCON = (1 << ENASTB);
+
+    DEBUG_PRINT("CAN bit rate index: ");
+    DEBUG_PRINT_NUM(baud);
+    DEBUG_PRINTLN("");
+    DEBUG_PRINT("CAN node address: ");
+    DEBUG_PRINT_HEX(node_addr);
+    DEBUG_PRINTLN("");
+
+    // Address claim goes out from the main loop
+    J1939_init(node_addr);
 }
 
 Status_t CAN_process_message(void) {
-    if (buffer_count >= CAN_BUFFER_SIZE) {
-        DEBUG_PRINTLN("CAN buffer full");
-        return BUSY;
-    }
-    
-    // Check if message is available
-    if (CANSIT2 & (1 << SIT0)) {
+    Status_t status = NOT_READY;
+    PROFILE_BEGIN(PROF_CAN_PROCESS);
+
+    if (buffer_count > 0) {
         DEBUG_PRINTLN("CAN message received");
-        CANPAGE = 0x00;
-        
-        // Read received ID
-        uint32_t received_id = ((uint32_t)CANIDT1 << 21) |
-                             ((uint32_t)CANIDT2 << 13) |
-                             ((uint32_t)CANIDT3 << 5) |
-                             ((uint32_t)CANIDT4 >> 3);
-        
-        // Filter for our target ID
-        if (received_id == CAN_MSG_ID) {
-            // Read message data
-            DEBUG_PRINT("Valid CAN ID: ");
-            DEBUG_PRINT_HEX(received_id);
-            DEBUG_PRINTLN("");
-            for (uint8_t i = 0; i < 8; i++) {
-                CANPAGE = (i << INDX0);
-                can_buffer[buffer_head].data[i] = CANMSG;
-                DEBUG_PRINT("Data[");
-                DEBUG_PRINT_NUM(i);
-                DEBUG_PRINT("]: ");
-                DEBUG_PRINT_HEX(can_buffer[buffer_head].data[i]);
-                DEBUG_PRINTLN("");
-            }
-            
-            can_buffer[buffer_head].id = received_id;
-            can_buffer[buffer_head].length = 8;
-            
-            buffer_head = (buffer_head + 1) % CAN_BUFFER_SIZE;
-            buffer_count++;
-            
-            // Toggle CAN LED
-            DEBUG_PRINTLN("CAN message stored in buffer");
-            LED_set(LED_CAN, LED_BLINK, 100);
-            DEBUG_PRINTLN("CAN LED triggered");
-            
-            return SUCCESS;
-        }
-        
-        // Clear interrupt flags
-        CANSTMOB = 0x00;
-        CANGIT |= (1 << CANIT);
-        
-        // Re-enable reception
-        CANCDMOB = (1 << CONMOB1);
+
+        // CAN activity heartbeat
+        LED_set_pattern(LED_CAN, LED_PATTERN_HEARTBEAT, LED_HEARTBEAT_LENGTH, LED_HEARTBEAT_STEP_MS);
+        DEBUG_PRINTLN("CAN LED triggered");
+        status = SUCCESS;
     }
-    
-    return NOT_READY;
+
+    PROFILE_END(PROF_CAN_PROCESS);
+    return status;
 }
 
 Status_t CAN_extract(CAN_Message_t *msg) {
+    cli();
     if (buffer_count == 0) {
+        sei();
         return NOT_READY;
     }
-    
-    *msg = can_buffer[buffer_tail];
+
+    msg->id = can_buffer[buffer_tail].id;
+    msg->length = can_buffer[buffer_tail].length;
+    for (uint8_t i = 0; i < 8; i++) {
+        msg->data[i] = can_buffer[buffer_tail].data[i];
+    }
     buffer_tail = (buffer_tail + 1) % CAN_BUFFER_SIZE;
     buffer_count--;
-    
+    sei();
+
+    DEBUG_PRINT("Valid CAN ID: ");
+    DEBUG_PRINT_HEX(msg->id);
+    DEBUG_PRINTLN("");
+    for (uint8_t i = 0; i < 8; i++) {
+        DEBUG_PRINT("Data[");
+        DEBUG_PRINT_NUM(i);
+        DEBUG_PRINT("]: ");
+        DEBUG_PRINT_HEX(msg->data[i]);
+        DEBUG_PRINTLN("");
+    }
+
     return SUCCESS;
 }
 
+#if BENCHMARK_ENABLED
+// Queue a frame the way the ISR does, for Bench_run()
+Status_t CAN_inject(const CAN_Message_t *msg) {
+    uint8_t sreg = SREG;
+    cli();
+    if (buffer_count >= CAN_BUFFER_SIZE) {
+        SREG = sreg;
+        return BUSY;
+    }
+    can_buffer[buffer_head].id = msg->id;
+    can_buffer[buffer_head].length = msg->length;
+    for (uint8_t i = 0; i < 8; i++) {
+        can_buffer[buffer_head].data[i] = msg->data[i];
+    }
+    buffer_head = (buffer_head + 1) % CAN_BUFFER_SIZE;
+    buffer_count++;
+    SREG = sreg;
+
+    return SUCCESS;
+}
+#endif
+
+Status_t CAN_send(const CAN_Message_t *msg) {
+    Status_t status = SUCCESS;
+
+    if (msg->length > 8) {
+        return INVALID_PARAM;
+    }
+
+    cli();
+    CANPAGE = (CAN_TX_MOB << MOBNB0);  // Data index 0, auto-increment
+
+    if (CANEN2 & (1 << ENMOB1)) {
+        // Previous frame still waiting for arbitration
+        can_stats.tx_busy++;
+        status = BUSY;
+    } else {
+        CANSTMOB = 0x00;
+        CANIDT1 = (uint8_t)(msg->id >> 21);
+        CANIDT2 = (uint8_t)(msg->id >> 13);
+        CANIDT3 = (uint8_t)(msg->id >> 5);
+        CANIDT4 = (uint8_t)(msg->id << 3);
+        for (uint8_t i = 0; i < msg->length; i++) {
+            CANMSG = msg->data[i];
+        }
+        CANCDMOB = (1 << CONMOB0) | (1 << IDE) | msg->length;
+        can_stats.tx_frames++;
+    }
+    sei();
+
+    return status;
+}
+
+Status_t CAN_send_status(uint8_t sequence, uint16_t outputs, uint8_t error) {
+    CAN_Message_t status;
+    CAN_Stats_t stats;
+
+    // Nothing but address claims before the claim has settled
+    if (!J1939_is_claimed()) {
+        return NOT_READY;
+    }
+
+    CAN_get_stats(&stats);
+
+    status.id = CAN_STATUS_ID_BASE | J1939_get_address();
+    status.length = 8;
+    status.data[0] = sequence;
+    status.data[1] = (uint8_t)outputs;
+    status.data[2] = (uint8_t)(outputs >> 8);
+    status.data[3] = error;
+    status.data[4] = (uint8_t)stats.rx_accepted;
+    status.data[5] = (uint8_t)(stats.rx_accepted >> 8);
+    status.data[6] = (uint8_t)stats.rx_dropped;
+    status.data[7] = (uint8_t)(stats.rx_dropped >> 8);
+
+    return CAN_send(&status);
+}
+
+void CAN_get_stats(CAN_Stats_t *stats) {
+    cli();
+    stats->rx_frames = can_stats.rx_frames;
+    stats->rx_accepted = can_stats.rx_accepted;
+    stats->rx_dropped = can_stats.rx_dropped;
+    stats->tx_frames = can_stats.tx_frames;
+    stats->tx_busy = can_stats.tx_busy;
+    sei();
+}
+
+CAN_Baud_t CAN_get_baud(void) {
+    return baud;
+}
+
+uint8_t CAN_get_node_addr(void) {
+    return J1939_get_address();
+}
+
 /**
  * @brief CAN interrupt handler
  */
 ISR(CANIT_vect)
 {
-    // Select MOb0
-    CANPAGE = 0x00;
-    
-    if (CANSIT2 & (1 << SIT0)) {  // Check if MOb0 has received a message
-        // Read received ID
-        can_message.id = ((uint32_t)CANIDT1 << 21) |
-                         ((uint32_t)CANIDT2 << 13) |
-                         ((uint32_t)CANIDT3 << 5) |
-                         ((uint32_t)CANIDT4 >> 3);
-        
-        // Read message length
-        can_message.dlc = (CANCDMOB & 0x0F);
-        
-        // Read message data
-        for (uint8_t i = 0; i < 8; i++) {
-            CANPAGE = (i << INDX0);  // Select data byte
-            can_message.data[i] = CANMSG;
+    Load_isr_enter();
+    PROFILE_BEGIN(PROF_ISR_CAN);
+    uint8_t saved_page = CANPAGE;
+    uint8_t pending = CANSIT2;
+
+    // Command frames, the MOb filter already matched PGN and source
+    if (pending & (1 << SIT0)) {
+        CANPAGE = (CAN_RX_MOB << MOBNB0);  // Data index 0, auto-increment
+        if (!Fault_can_drop()) {
+            can_stats.rx_frames++;
+            if (buffer_count < CAN_BUFFER_SIZE) {
+                for (uint8_t i = 0; i < 8; i++) {
+                    can_buffer[buffer_head].data[i] = CANMSG;
+                }
+                can_buffer[buffer_head].id = can_mob_read_id();
+                can_buffer[buffer_head].length = (CANCDMOB & 0x0F);
+
+                buffer_head = (buffer_head + 1) % CAN_BUFFER_SIZE;
+                buffer_count++;
+                can_stats.rx_accepted++;
+                // Only a frame the main loop will see keeps the master alive
+                Cmd_frame_received();
+            } else {
+                // Main loop has not drained the buffer in time
+                can_stats.rx_dropped++;
+            }
+#if FAULT_INJECTION_ENABLED
+            // Same frame once more, as if the master had repeated it
+            if (Fault_can_duplicate() && buffer_count > 0 && buffer_count < CAN_BUFFER_SIZE) {
+                uint8_t last = (buffer_head + CAN_BUFFER_SIZE - 1) % CAN_BUFFER_SIZE;
+                can_buffer[buffer_head] = can_buffer[last];
+                buffer_head = (buffer_head + 1) % CAN_BUFFER_SIZE;
+                buffer_count++;
+                Cmd_frame_received();
+            }
+#endif
         }
-        
-        // Set message received flag
-        message_received = 1;
-        
-        // Toggle CAN LED
-        LED_Set(LED_CAN, LED_BLINK, 50);
-        DEBUG_PRINTLN("ISR_CAN done");
-    }
-    
-    // Clear interrupt flags
-    CANSTMOB = 0x00;  // Clear MOb status
-    CANGIT |= (1 << CANIT);  // Clear general interrupt
-    
-    // Re-enable reception
-    CANCDMOB = (1 << CONMOB1);
-}
\ No newline at end of file
+
+        // Clear MOb status and re-enable reception
+        CANSTMOB = 0x00;
+        CANCDMOB = CAN_RX_ENABLE;
+    }
+
+    // J1939 network management, handled from the main loop
+    for (uint8_t mob = CAN_REQUEST_MOB; mob <= CAN_CLAIM_MOB; mob++) {
+        if (pending & (1 << mob)) {
+            uint8_t data[8];
+
+            CANPAGE = (mob << MOBNB0);
+            can_stats.rx_frames++;
+            for (uint8_t i = 0; i < 8; i++) {
+                data[i] = CANMSG;
+            }
+            J1939_frame_received(can_mob_read_id(), data, CANCDMOB & 0x0F);
+
+            CANSTMOB = 0x00;
+            CANCDMOB = CAN_RX_ENABLE;
+        }
+    }
+
+    // Count error frames and handle bus-off before the flags are cleared
+    CAN_error_interrupt();
+
+    // Clear general interrupt
+    CANGIT |= (1 << CANIT);
+
+    CANPAGE = saved_page;
+    PROFILE_END(PROF_ISR_CAN);
+}
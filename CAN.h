@@ -6,14 +6,43 @@
 
 #define CAN_BUFFER_SIZE 2
 
+// Bit-rate index stored at EEPROM_CAN_BAUD
+typedef enum {
+    CAN_BAUD_125K = 0,
+    CAN_BAUD_250K,
+    CAN_BAUD_500K,
+    CAN_BAUD_1M,
+    CAN_BAUD_COUNT
+} CAN_Baud_t;
+
+#define CAN_BAUD_DEFAULT ((CAN_BAUD_RATE) == 125000 ? CAN_BAUD_125K : \
+                          (CAN_BAUD_RATE) == 500000 ? CAN_BAUD_500K : \
+                          (CAN_BAUD_RATE) == 1000000 ? CAN_BAUD_1M : CAN_BAUD_250K)
+
 typedef struct {
     uint32_t id;
     uint8_t data[8];
     uint8_t length;
 } CAN_Message_t;
 
+typedef struct {
+    uint16_t rx_frames;    // Every frame passing the MOb filters
+    uint16_t rx_accepted;  // Command frames queued for the main loop
+    uint16_t rx_dropped;   // Command frames lost to a full buffer
+    uint16_t tx_frames;    // Frames handed to the TX MOb
+    uint16_t tx_busy;      // Frames skipped because the TX MOb was busy
+} CAN_Stats_t;
+
 void CAN_init(void);
 Status_t CAN_process_message(void);
 Status_t CAN_extract(CAN_Message_t *msg);
+Status_t CAN_send(const CAN_Message_t *msg);
+Status_t CAN_send_status(uint8_t sequence, uint16_t outputs, uint8_t error);
+void CAN_get_stats(CAN_Stats_t *stats);
+uint8_t CAN_get_node_addr(void);
+CAN_Baud_t CAN_get_baud(void);
+#if BENCHMARK_ENABLED
+Status_t CAN_inject(const CAN_Message_t *msg);
+#endif
 
 #endif // CAN_H
\ No newline at end of file
@@ -1,93 +1,118 @@
 #include "led.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include "system_timer.h"
+#include "profiler.h"
+#include "soft_timer.h"
 
 typedef struct {
-    volatile uint8_t *port;
-    volatile uint8_t *ddr;
-    uint8_t pin;
-    LED_State_t state;
-    uint16_t blink_period;
-    uint32_t last_toggle_time;
-    bool current_state;
-} LED_Config_t;
+    uint32_t pattern;     // One bit per step, LSB first, 1 = on
+    uint8_t length;       // Steps in the pattern (1..32)
+    uint8_t step;         // Current step
+    uint16_t step_ms;     // Step duration
+    uint8_t code;         // Active flash code, blocks other patterns while non-zero
+    Soft_Timer_t timer;   // Armed only for patterns longer than one step
+} LED_Sequence_t;
 
-static LED_Config_t led_config[LED_COUNT];
+static LED_Sequence_t led_seq[LED_COUNT];
+
+// Constant led folds to a single sbi/cbi
+static inline void led_write(LED_t led, bool on) {
+    switch (led) {
+        BOARD_LED_LIST(BOARD_CASE_WRITE)
+        default: break;
+    }
+}
+
+// Timer callback, advances one LED to its next step
+static void led_step(void *arg) {
+    LED_t led = (LED_t)(uintptr_t)arg;
+    LED_Sequence_t *seq = &led_seq[led];
+    PROFILE_BEGIN(PROF_LED_UPDATE);
+
+    if (++seq->step >= seq->length) {
+        seq->step = 0;
+    }
+    led_write(led, (seq->pattern >> seq->step) & 0x01);
+    PROFILE_END(PROF_LED_UPDATE);
+}
 
 void LED_init(void) {
-    // Power LED (PC4)
-    led_config[LED_POWER].port = &PORTC;
-    led_config[LED_POWER].ddr = &DDRC;
-    led_config[LED_POWER].pin = PC5;
-    
-    // CAN LED (PB0)
-    led_config[LED_CAN].port = &PORTB;
-    led_config[LED_CAN].ddr = &DDRB;
-    led_config[LED_CAN].pin = PB0;
-    
-    // Output LED (PB3)
-    led_config[LED_OUTPUT].port = &PORTB;
-    led_config[LED_OUTPUT].ddr = &DDRB;
-    led_config[LED_OUTPUT].pin = PB3;
-    
-    // Mode LED (PB6)
-    led_config[LED_MODE].port = &PORTB;
-    led_config[LED_MODE].ddr = &DDRB;
-    led_config[LED_MODE].pin = PB6;
-    
-    // Initialize all LEDs
+    // Configure all LEDs as outputs, off
+    BOARD_LED_LIST(BOARD_SET_OUTPUT)
+    BOARD_LED_LIST(BOARD_CLEAR)
+
     for (uint8_t i = 0; i < LED_COUNT; i++) {
-        *(led_config[i].ddr) |= (1 << led_config[i].pin);
-        *(led_config[i].port) &= ~(1 << led_config[i].pin);
-        led_config[i].state = LED_OFF;
-        led_config[i].blink_period = 0;
-        led_config[i].last_toggle_time = 0;
-        led_config[i].current_state = false;
+        led_seq[i].pattern = 0;
+        led_seq[i].length = 1;
+        led_seq[i].step = 0;
+        led_seq[i].step_ms = 0;
+        led_seq[i].code = 0;
+        Timer_setup(&led_seq[i].timer, led_step, (void *)(uintptr_t)i);
     }
-    
-    
 }
 
-void LED_set(LED_t led, LED_State_t state, uint16_t blink_period) {
-    if (led >= LED_COUNT) return;
-    
+static void led_apply(LED_t led, uint32_t pattern, uint8_t length, uint16_t step_ms) {
+    if (length == 0 || length > 32) length = 1;
+    if (step_ms == 0) step_ms = 1;
+
+    uint8_t sreg = SREG;
     cli();
-    led_config[led].state = state;
-    led_config[led].blink_period = blink_period;
-    
+    LED_Sequence_t *seq = &led_seq[led];
+    // Re-requesting the running pattern must not restart it
+    if (seq->pattern != pattern || seq->length != length || seq->step_ms != step_ms) {
+        seq->pattern = pattern;
+        seq->length = length;
+        seq->step = 0;
+        seq->step_ms = step_ms;
+        led_write(led, pattern & 0x01);
+        if (length > 1) {
+            Timer_arm(&seq->timer, step_ms, step_ms);
+        } else {
+            Timer_cancel(&seq->timer);
+        }
+    }
+    SREG = sreg;
+}
+
+// Activity and status patterns, ignored while a flash code is shown
+void LED_set_pattern(LED_t led, uint32_t pattern, uint8_t length, uint16_t step_ms) {
+    if (led >= LED_COUNT || led_seq[led].code) return;
+    led_apply(led, pattern, length, step_ms);
+}
+
+void LED_set(LED_t led, LED_State_t state, uint16_t blink_period) {
     switch (state) {
         case LED_OFF:
-            *(led_config[led].port) &= ~(1 << led_config[led].pin);
-            led_config[led].current_state = false;
+            LED_set_pattern(led, 0, 1, 0);
             break;
         case LED_ON:
-            *(led_config[led].port) |= (1 << led_config[led].pin);
-            led_config[led].current_state = true;
+            LED_set_pattern(led, 1, 1, 0);
             break;
         case LED_BLINK:
-            led_config[led].last_toggle_time = system_timer_get_ms();
-            *(led_config[led].port) |= (1 << led_config[led].pin);
-            led_config[led].current_state = true;
+            // On for one period, off for one period
+            LED_set_pattern(led, 0x01, 2, blink_period);
             break;
     }
-    sei();
 }
 
-void LED_status_update(void) {
-    uint32_t current_time = system_timer_get_ms();
-    
-    for (uint8_t i = 0; i < LED_COUNT; i++) {
-        if (led_config[i].state == LED_BLINK && led_config[i].blink_period > 0) {
-            if ((current_time - led_config[i].last_toggle_time) >= led_config[i].blink_period) {
-                if (led_config[i].current_state) {
-                    *(led_config[i].port) &= ~(1 << led_config[i].pin);
-                } else {
-                    *(led_config[i].port) |= (1 << led_config[i].pin);
-                }
-                led_config[i].current_state = !led_config[i].current_state;
-                led_config[i].last_toggle_time = current_time;
-            }
-        }
+// A newer code replaces the shown one, count 0 clears it
+void LED_set_flash_code(LED_t led, uint8_t count) {
+    if (led >= LED_COUNT) return;
+    if (count > LED_FLASH_CODE_MAX) count = LED_FLASH_CODE_MAX;
+    led_seq[led].code = count;
+    if (count == 0) {
+        led_apply(led, 0, 1, 0);
+        return;
+    }
+
+    // count x (on, off) followed by a pause
+    uint32_t pattern = ((1UL << (2 * count)) - 1) & 0x55555555UL;
+    led_apply(led, pattern, 2 * count + LED_FLASH_PAUSE_STEPS, LED_FLASH_STEP_MS);
+}
+
+// Release the LED for activity patterns if it still shows this code
+void LED_clear_flash_code(LED_t led, uint8_t count) {
+    if (led < LED_COUNT && led_seq[led].code == count) {
+        LED_set_flash_code(led, 0);
     }
 }
@@ -2,12 +2,11 @@
 #define LED_H
 
 #include "common.h"
+#include "board.h"
 
+// Pins are assigned in BOARD_LED_LIST
 typedef enum {
-    LED_POWER = 0,
-    LED_CAN,
-    LED_OUTPUT,
-    LED_MODE,
+    BOARD_LED_LIST(BOARD_ENUM)
     LED_COUNT
 } LED_t;
 
@@ -17,8 +16,22 @@ typedef enum {
     LED_BLINK
 } LED_State_t;
 
+// N-flash fault codes: N x (on, off) steps, then a pause. A code has
+// priority over LED_set/LED_set_pattern until it is cleared, otherwise it
+// stays until reset so a technician can still read it
+#define LED_FLASH_STEP_MS 250
+#define LED_FLASH_PAUSE_STEPS 6
+#define LED_FLASH_CODE_MAX 13
+
+// CAN activity heartbeat: two short blips per second
+#define LED_PATTERN_HEARTBEAT 0x00000005UL
+#define LED_HEARTBEAT_LENGTH 10
+#define LED_HEARTBEAT_STEP_MS 100
+
 void LED_init(void);
 void LED_set(LED_t led, LED_State_t state, uint16_t blink_period);
-void LED_status_update(void);
+void LED_set_pattern(LED_t led, uint32_t pattern, uint8_t length, uint16_t step_ms);
+void LED_set_flash_code(LED_t led, uint8_t count);
+void LED_clear_flash_code(LED_t led, uint8_t count);
 
 #endif // LED_H
\ No newline at end of file
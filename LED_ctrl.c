@@ -6,144 +6,121 @@
  */
 
 #include "LED_ctrl.h"
-#include "system_timer.h"
+#include "soft_timer.h"
 #include <avr/io.h>
-#include <util/delay.h>
+#include <avr/interrupt.h>
 #include <stdbool.h>
 
-// Structure to hold LED configuration
+// Pattern sequencer state, pins come from board.h
 typedef struct {
-    volatile uint8_t *port;
-    volatile uint8_t *ddr;
-    uint8_t pin;
-    LED_State_t state;
-    uint16_t blink_period;
-    uint32_t last_toggle;
-    bool current_state;
-} LED_Config_t;
+    uint32_t pattern;     // One bit per step, LSB first, 1 = on
+    uint8_t length;       // Steps in the pattern (1..32)
+    uint8_t step;         // Current step
+    uint16_t step_ms;     // Step duration
+    Soft_Timer_t timer;   // Armed only for patterns longer than one step
+} LED_Sequence_t;
 
-// LED configurations
-static LED_Config_t led_config[LED_COUNT];
+// LED sequences
+static LED_Sequence_t led_seq[LED_COUNT];
 
-// Get current time in milliseconds
-static uint32_t get_current_time(void)
+// Drive one LED, a constant led folds to a single sbi/cbi
+static inline void led_write(LED_t led, bool on)
 {
-    return Timer_GetMillis();
+    switch (led) {
+        BOARD_RGB_LED_LIST(BOARD_CASE_WRITE)
+        default: break;
+    }
+}
+
+// Timer callback, advances one LED to its next step
+static void led_step(void *arg)
+{
+    LED_t led = (LED_t)(uintptr_t)arg;
+    LED_Sequence_t *seq = &led_seq[led];
+    
+    if (++seq->step >= seq->length) {
+        seq->step = 0;
+    }
+    led_write(led, (seq->pattern >> seq->step) & 0x01);
 }
 
 // Initialize LED configurations
 void LED_Init(void)
 {
-    // Configure LED1 (PORT C)
-    led_config[LED1_RED].port = &PORTC;
-    led_config[LED1_RED].ddr = &DDRC;
-    led_config[LED1_RED].pin = PC4;
-    
-    led_config[LED1_GREEN].port = &PORTC;
-    led_config[LED1_GREEN].ddr = &DDRC;
-    led_config[LED1_GREEN].pin = PC5;
-    
-    led_config[LED1_BLUE].port = &PORTC;
-    led_config[LED1_BLUE].ddr = &DDRC;
-    led_config[LED1_BLUE].pin = PC6;
-    
-    // Configure LED2 (PORT B)
-    led_config[LED2_RED].port = &PORTB;
-    led_config[LED2_RED].ddr = &DDRB;
-    led_config[LED2_RED].pin = PB0;
+    // Configure all LEDs as outputs and turn them off initially (active high)
+    BOARD_RGB_LED_LIST(BOARD_SET_OUTPUT)
+    BOARD_RGB_LED_LIST(BOARD_CLEAR)
     
-    led_config[LED2_GREEN].port = &PORTB;
-    led_config[LED2_GREEN].ddr = &DDRB;
-    led_config[LED2_GREEN].pin = PB1;
-    
-    led_config[LED2_BLUE].port = &PORTB;
-    led_config[LED2_BLUE].ddr = &DDRB;
-    led_config[LED2_BLUE].pin = PB2;
-    
-    // Configure LED3 (PORT B)
-    led_config[LED3_RED].port = &PORTB;
-    led_config[LED3_RED].ddr = &DDRB;
-    led_config[LED3_RED].pin = PB3;
-    
-    led_config[LED3_GREEN].port = &PORTB;
-    led_config[LED3_GREEN].ddr = &DDRB;
-    led_config[LED3_GREEN].pin = PB4;
-    
-    led_config[LED3_BLUE].port = &PORTB;
-    led_config[LED3_BLUE].ddr = &DDRB;
-    led_config[LED3_BLUE].pin = PB5;
-    
-    // Configure LED4 (PORT B and PORT G)
-    led_config[LED4_RED].port = &PORTB;
-    led_config[LED4_RED].ddr = &DDRB;
-    led_config[LED4_RED].pin = PB6;
-    
-    led_config[LED4_GREEN].port = &PORTB;
-    led_config[LED4_GREEN].ddr = &DDRB;
-    led_config[LED4_GREEN].pin = PB7;
-    
-    led_config[LED4_BLUE].port = &PORTG;
-    led_config[LED4_BLUE].ddr = &DDRG;
-    led_config[LED4_BLUE].pin = PG0;
-    
-    // Configure all LEDs as outputs and turn them off initially
     for (uint8_t i = 0; i < LED_COUNT; i++) {
-        *(led_config[i].ddr) |= (1 << led_config[i].pin);
-        *(led_config[i].port) &= ~(1 << led_config[i].pin); // Active high logic
-        led_config[i].state = OFF;
-        led_config[i].blink_period = 0;
-        led_config[i].last_toggle = 0;
-        led_config[i].current_state = false;
+        led_seq[i].pattern = 0;
+        led_seq[i].length = 1;
+        led_seq[i].step = 0;
+        led_seq[i].step_ms = 0;
+        Timer_setup(&led_seq[i].timer, led_step, (void *)(uintptr_t)i);
     }
 }
 
-// Set LED state
-void LED_Set(LED_t led, LED_State_t state, uint16_t blink_period)
+// Start a pattern, re-requesting the running pattern does not restart it
+void LED_SetPattern(LED_t led, uint32_t pattern, uint8_t length, uint16_t step_ms)
 {
     if (led >= LED_COUNT) {
         return;
     }
+    if (length == 0 || length > 32) {
+        length = 1;
+    }
+    if (step_ms == 0) {
+        step_ms = 1;
+    }
     
-    led_config[led].state = state;
-    
+    uint8_t sreg = SREG;
+    cli();
+    LED_Sequence_t *seq = &led_seq[led];
+    if (seq->pattern != pattern || seq->length != length || seq->step_ms != step_ms) {
+        seq->pattern = pattern;
+        seq->length = length;
+        seq->step = 0;
+        seq->step_ms = step_ms;
+        led_write(led, pattern & 0x01);
+        if (length > 1) {
+            Timer_arm(&seq->timer, step_ms, step_ms);
+        } else {
+            Timer_cancel(&seq->timer);
+        }
+    }
+    SREG = sreg;
+}
+
+// Set LED state
+void LED_Set(LED_t led, LED_State_t state, uint16_t blink_period)
+{
     switch (state) {
         case OFF:
-            *(led_config[led].port) &= ~(1 << led_config[led].pin);
-            led_config[led].current_state = false;
+            LED_SetPattern(led, 0, 1, 0);
             break;
         case ON:
-            *(led_config[led].port) |= (1 << led_config[led].pin);
-            led_config[led].current_state = true;
+            LED_SetPattern(led, 1, 1, 0);
             break;
         case BLINK:
-            led_config[led].blink_period = blink_period;
-            led_config[led].last_toggle = get_current_time();
-            led_config[led].current_state = true;
-            *(led_config[led].port) |= (1 << led_config[led].pin);
+            // On for one period, off for one period
+            LED_SetPattern(led, 0x01, 2, blink_period);
             break;
         default:
             break;
     }
 }
 
-// Update LED states (to be called regularly)
-void LED_Update(void)
+// Show an N-flash code followed by a pause
+void LED_SetFlashCode(LED_t led, uint8_t count)
 {
-    uint32_t current_time = get_current_time();
-    
-    for (uint8_t i = 0; i < LED_COUNT; i++) {
-        if (led_config[i].state == BLINK && led_config[i].blink_period > 0) {
-            if ((current_time - led_config[i].last_toggle) >= led_config[i].blink_period) {
-                // Toggle LED
-                if (led_config[i].current_state) {
-                    *(led_config[i].port) &= ~(1 << led_config[i].pin);
-                    led_config[i].current_state = false;
-                } else {
-                    *(led_config[i].port) |= (1 << led_config[i].pin);
-                    led_config[i].current_state = true;
-                }
-                led_config[i].last_toggle = current_time;
-            }
-        }
+    if (count > LED_FLASH_CODE_MAX) {
+        count = LED_FLASH_CODE_MAX;
     }
-}
\ No newline at end of file
+    if (count == 0) {
+        LED_Set(led, OFF, 0);
+        return;
+    }
+    
+    uint32_t pattern = ((1UL << (2 * count)) - 1) & 0x55555555UL;
+    LED_SetPattern(led, pattern, 2 * count + LED_FLASH_PAUSE_STEPS, LED_FLASH_STEP_MS);
+}
@@ -4,6 +4,7 @@
 #include <avr/io.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "board.h"
 
 // LED states
 typedef enum {
@@ -12,25 +13,19 @@ typedef enum {
     BLINK = 2
 } LED_State_t;
 
-// LED definitions
+// LED definitions, pins are assigned in BOARD_RGB_LED_LIST
 typedef enum {
-    LED1_RED = 0,
-    LED1_GREEN,
-    LED1_BLUE,
-    LED2_RED,
-    LED2_GREEN,
-    LED2_BLUE,
-    LED3_RED,
-    LED3_GREEN,
-    LED3_BLUE,
-    LED4_RED,
-    LED4_GREEN,
-    LED4_BLUE,
+    BOARD_RGB_LED_LIST(BOARD_ENUM)
     LED_COUNT
 } LED_t;
 
+// N-flash fault codes: N x (on, off) steps, then a pause
+#define LED_FLASH_STEP_MS 250
+#define LED_FLASH_PAUSE_STEPS 6
+#define LED_FLASH_CODE_MAX 13
+
 /**
- * @brief Initialize LED module
+ * @brief Initialize LED module, patterns step from soft timers
  * @return None
  */
 void LED_Init(void);
@@ -45,9 +40,21 @@ void LED_Init(void);
 void LED_Set(LED_t led, LED_State_t state, uint16_t blink_period);
 
 /**
- * @brief Update function to be called periodically (for blink handling)
+ * @brief Play a repeating bit pattern
+ * @param led LED to control
+ * @param pattern One bit per step, LSB first, 1 = on
+ * @param length Number of steps (1..32)
+ * @param step_ms Step duration in ms
+ * @return None
+ */
+void LED_SetPattern(LED_t led, uint32_t pattern, uint8_t length, uint16_t step_ms);
+
+/**
+ * @brief Show an N-flash fault code
+ * @param led LED to control
+ * @param count Number of flashes (0 turns the LED off)
  * @return None
  */
-void LED_Update(void);
+void LED_SetFlashCode(LED_t led, uint8_t count);
 
 #endif /* LED_CTRL_H */
\ No newline at end of file
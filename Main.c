@@ -8,10 +8,73 @@
 #include "debug.h"
 #include "system_timer.h"
 #include "mode_controller.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "mem_monitor.h"
+#include "soft_timer.h"
+#include "cmd_monitor.h"
+#include "j1939.h"
+#include "can_error.h"
+#include "cpu_load.h"
+#include "supervisor.h"
+#include "event_log.h"
+#include "fault_inject.h"
+#include "benchmark.h"
+#include "current_cal.h"
+#include "capture.h"
+#include "coil_diag.h"
+#include "stream.h"
+
+// Periodic main-loop tasks, flagged from the timer wheel
+typedef enum {
+    TASK_CAN = 0,
+    TASK_CURRENT,
+    TASK_MEM_SCAN,
+    TASK_TELEMETRY,
+    TASK_PROFILE_DUMP,
+    TASK_CPU_LOAD,
+    TASK_EVENT_PERSIST,
+    TASK_COUNT
+} Task_t;
+
+static volatile uint8_t tasks_due = 0;
+static Soft_Timer_t task_timers[TASK_COUNT];
+
+static void task_set_due(void *arg) {
+    tasks_due |= (1 << (uint8_t)(uintptr_t)arg);
+}
+
+static void task_start(Task_t task, uint32_t period_ms) {
+    Timer_setup(&task_timers[task], task_set_due, (void *)(uintptr_t)task);
+    Timer_arm(&task_timers[task], period_ms, period_ms);
+}
+
+static uint8_t task_take_due(void) {
+    uint8_t due;
+
+    cli();
+    due = tasks_due;
+    tasks_due = 0;
+    sei();
+
+    return due;
+}
+
+// Sleep until the next interrupt unless a task became due meanwhile. A flag
+// raised between its check and here waits at most for the next 1 ms tick.
+static void idle_until_interrupt(void) {
+    cli();
+    if (tasks_due == 0) {
+        Load_sleep();
+    }
+    sei();
+}
 
 void system_init(void) {
     // Initialize all subsystems
-    //system_timer_init();  // Initialize timer first
+    Timer_init();
+    system_timer_init();  // Initialize timer first
+    Profile_init();
     debug_init();
     DEBUG_PRINTLN("System starting...");
     // Rest of the Initialization
@@ -23,6 +86,15 @@ void system_init(void) {
     Sys_init_solenoid();
     Sys_init_monitor();
     
+    Mem_init();
+    Load_init();
+    Event_init();
+    Event_dump();
+    Bench_run();  // Before the watchdog starts
+    Sup_init();  // Watchdog runs from here on
+    Fault_init();
+    Capture_init();
+    Stream_init();  // Takes the debug UART over
     DEBUG_PRINTLN("System initialized");
     // Enable global interrupts
     sei();
@@ -30,65 +102,105 @@ void system_init(void) {
 
 void main_loop(void) {
     CAN_Message_t msg;
-    uint32_t last_current_check = 0;
-    uint32_t last_can_check = 0;
-    uint32_t last_led_update = 0;
-    uint32_t last_mode_update = 0;
-    uint32_t current_time;
-    bool output_changed = false;
+    uint16_t prev_signals = 0;
+
+    task_start(TASK_CAN, 10);
+    task_start(TASK_CURRENT, 100);
+    task_start(TASK_MEM_SCAN, MEM_SCAN_PERIOD_MS);
+    task_start(TASK_TELEMETRY, TELEMETRY_PERIOD_MS);
+    task_start(TASK_CPU_LOAD, CPU_LOAD_WINDOW_MS);
+    task_start(TASK_EVENT_PERSIST, EVENT_PERSIST_PERIOD_MS);
+#if PROFILING_ENABLED
+    task_start(TASK_PROFILE_DUMP, PROFILE_DUMP_PERIOD_MS);
+#endif
 
     while (1) {
-        current_time = system_timer_get_ms();
+        uint8_t due = task_take_due();
         
         // Process CAN messages every 10ms
-        if (current_time - last_can_check >= 100) {
+        if (due & (1 << TASK_CAN)) {
+            Sup_checkin(SUP_CAN);
+            Fault_update();
+            CAN_error_update();
+            J1939_update();
             if (CAN_process_message() == SUCCESS) {
                 while (CAN_extract(&msg) == SUCCESS) {
-                    // Process each received message
-                    for (uint8_t i = 0; i < 8; i++) {
-                        Function_t func = CAN_get_function_from_data(i, msg.data[i]);
-                        if (func != FUNCTION_COUNT) {
-                            bool current_state = Sol_read_pin_state(func);
-                            Sol_set_pin_state(func, !current_state);
-                            output_changed = true;
-                        }
-                    }
-                    if (output_changed) {
+                    // Only functions whose bit changed since the previous frame
+                    // matter, a repeated cyclic frame costs one XOR
+                    uint16_t signals = CAN_decode_functions(msg.data);
+                    uint16_t changed = signals ^ prev_signals;
+                    Sol_update_duties(msg.data);
+                    if (changed) {
+                        // A turn-on refused for the channel limit stays a rising
+                        // edge, it takes effect once a channel frees up
+                        uint16_t refused = Sol_apply_edges(signals & changed, prev_signals & changed);
+                        prev_signals = signals & ~refused;
                         Sol_set_output();
-                        // Check if any outputs are active and notify error handler
-                        bool any_active = false;
-                        for (uint8_t j = 0; j < FUNCTION_COUNT; j++) {
-                            if (Sol_read_pin_state((Function_t)j)) {
-                                any_active = true;
-                                break;
-                            }
-                        }
-                        Err_set_output_active(any_active);
-                        output_changed = false;
+                        // Notify error handler whether any output is active
+                        Err_set_output_active(Sol_get_output_bitmap() != 0);
                     }
+                    // Answer every command so the master can measure latency and loss
+                    CAN_send_status(msg.data[7], Sol_get_output_bitmap(), Err_get_current_error());
                 }
             }
-            last_can_check = current_time;
+        }
+        
+        // Coils released from a reversal dead time
+        if (Sol_service()) {
+            Err_set_output_active(Sol_get_output_bitmap() != 0);
+        }
+        
+        // Waveform capture download, one chunk or line per pass
+        Capture_update();
+        Stream_update();
+        
+        // Master went silent: fail safe, latched outputs stay as they are
+        if (Cmd_take_timeout()) {
+            Sol_release_momentary();
+            prev_signals = 0;  // Held buttons count as new presses on resume
+            Err_set_output_active(Sol_get_output_bitmap() != 0);
+            Err_trigger_err_protocol(ERROR_CAN_COMM);
+        }
+        
+        // Bus-off: the controller recovers on its own, report it once
+        if (CAN_error_take_fault()) {
+            Err_trigger_err_protocol(ERROR_CAN_COMM);
         }
         
         // Check current ONLY if any output is active, and every 100ms
-        if ((current_time - last_current_check >= 100)) {
+        if (due & (1 << TASK_CURRENT)) {
             // Error handler will only check current if outputs are active
             Err_detect_sys_error();
-            last_current_check = current_time;
+            Cal_update();
+            Coil_update();
+            Sup_checkin(SUP_CURRENT);
+            Sol_commit_output();
         }
         
-        // Update LED states every 50ms
-        if (current_time - last_led_update >= 50) {
-            LED_status_update();
-            last_led_update = current_time;
+        // Track stack high-watermark
+        if (due & (1 << TASK_MEM_SCAN)) {
+            Mem_update();
         }
         
-        // Update mode controller state every 100ms to check LED timeout
-        if (current_time - last_mode_update >= 100) {
-            Mode_store_prev();
-            last_mode_update = current_time;
+        // Send one diagnostic frame per period
+        if (due & (1 << TASK_TELEMETRY)) {
+            Telemetry_update();
         }
+        
+        if (due & (1 << TASK_PROFILE_DUMP)) {
+            Profile_dump();
+        }
+        
+        if (due & (1 << TASK_CPU_LOAD)) {
+            Load_update();
+        }
+        
+        if (due & (1 << TASK_EVENT_PERSIST)) {
+            Event_persist();
+        }
+        Event_service();  // One EEPROM byte per pass, never waits
+        
+        idle_until_interrupt();
     }
 }
 
@@ -0,0 +1,172 @@
+#include "adc_scan.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "fault_inject.h"
+#include "capture.h"
+#include "stream.h"
+#include "cpu_load.h"
+
+// Timer0 compare match starts every conversion, the ISR moves the mux on
+#define ADC_TIMER_PRESCALER 64
+#define ADC_TIMER_OCR (F_CPU / ADC_TIMER_PRESCALER / ADC_SCAN_RATE_HZ - 1)
+
+_Static_assert(ADC_TIMER_OCR >= 1 && ADC_TIMER_OCR <= 255, "ADC_SCAN_RATE_HZ outside Timer0 range");
+// A conversion takes 13 ADC clocks at F_CPU / 128
+_Static_assert(ADC_SCAN_RATE_HZ <= F_CPU / 128 / 13, "ADC_SCAN_RATE_HZ faster than a conversion");
+_Static_assert(ADC_FILTER_SHIFT <= ADC_FRAC_BITS, "Filter state would overflow 16 bits");
+
+#define ADC_ENTRY_CHANNEL(name, ch, scale, zero, limit, coils) ch,
+#define ADC_ENTRY_SCALE(name, ch, scale, zero, limit, coils)   scale,
+#define ADC_ENTRY_ZERO(name, ch, scale, zero, limit, coils)    (uint16_t)((zero) << ADC_FRAC_BITS),
+#define ADC_ENTRY_LIMIT(name, ch, scale, zero, limit, coils)   limit,
+#define ADC_ENTRY_COILS(name, ch, scale, zero, limit, coils)   coils,
+#define ADC_ENTRY_DIDR(name, ch, scale, zero, limit, coils)    | (1 << (ch))
+
+static const uint8_t mux[SENSE_COUNT] = { BOARD_ADC_LIST(ADC_ENTRY_CHANNEL) };
+static const uint16_t scale_q8[SENSE_COUNT] = { BOARD_ADC_LIST(ADC_ENTRY_SCALE) };
+static const uint16_t limit_ma[SENSE_COUNT] = { BOARD_ADC_LIST(ADC_ENTRY_LIMIT) };
+static const uint16_t coils[SENSE_COUNT] = { BOARD_ADC_LIST(ADC_ENTRY_COILS) };
+static const uint16_t nominal_q6[SENSE_COUNT] = { BOARD_ADC_LIST(ADC_ENTRY_ZERO) };
+static uint16_t zero_q6[SENSE_COUNT] = { BOARD_ADC_LIST(ADC_ENTRY_ZERO) };  // Calibrated
+
+static volatile uint16_t raw[SENSE_COUNT];
+static volatile uint16_t filtered[SENSE_COUNT];  // Q6 counts
+static uint8_t scan_index = 0;                   // Input being converted
+
+void Adc_init(void) {
+    uint8_t didr = 0 BOARD_ADC_LIST(ADC_ENTRY_DIDR);
+
+    for (uint8_t i = 0; i < SENSE_COUNT; i++) {
+        raw[i] = zero_q6[i] >> ADC_FRAC_BITS;
+        filtered[i] = zero_q6[i];  // Reads zero current until the filter settles
+    }
+    scan_index = 0;
+
+    // Sense pins are analog only
+    DDRF &= ~didr;
+    DIDR0 |= didr;
+
+    // Timer0 CTC at ADC_SCAN_RATE_HZ, no interrupt, only the trigger flag
+    TCCR0A = (1 << WGM01) | (1 << CS01) | (1 << CS00);
+    OCR0A = ADC_TIMER_OCR;
+
+    // AVCC reference, auto trigger on Timer0 compare match, prescaler 128
+    ADMUX = (1 << REFS0) | (mux[0] & 0x1F);
+    ADCSRB = (1 << ADTS1) | (1 << ADTS0);
+    ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIE) |
+             (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+}
+
+// Conversion complete: store and filter the input, select the next one.
+// The trigger fires again on the next compare match, long after the mux
+// has settled.
+ISR(ADC_vect) {
+    uint16_t value = ADC;
+    uint16_t forced;
+
+    Load_isr_enter();
+    TIFR0 = (1 << OCF0A);  // Auto trigger needs a fresh flag edge
+    if (Fault_adc_forced(&forced)) {
+        value = forced;
+    }
+
+    // f += (value - f) / 2^n on Q6 counts, all unsigned
+    raw[scan_index] = value;
+    filtered[scan_index] = filtered[scan_index] - (filtered[scan_index] >> ADC_FILTER_SHIFT) +
+                      (value << (ADC_FRAC_BITS - ADC_FILTER_SHIFT));
+    if (scan_index == CAPTURE_INPUT) {
+        Capture_sample(value);
+    }
+    Stream_sample(scan_index, value);
+
+    if (++scan_index >= SENSE_COUNT) {
+        scan_index = 0;
+    }
+    ADMUX = (ADMUX & 0xE0) | (mux[scan_index] & 0x1F);
+}
+
+// Latest single conversion
+uint16_t Adc_get_raw(Adc_Channel_t channel) {
+    uint16_t value;
+    uint8_t sreg;
+
+    if (channel >= SENSE_COUNT) return 0;
+    sreg = SREG;
+    cli();
+    value = raw[channel];
+    SREG = sreg;
+    return value;
+}
+
+uint16_t Adc_get_filtered(Adc_Channel_t channel) {
+    uint16_t value;
+    uint8_t sreg;
+
+    if (channel >= SENSE_COUNT) return 0;
+    sreg = SREG;
+    cli();
+    value = filtered[channel];
+    SREG = sreg;
+    return value;
+}
+
+// Q6 counts to mA above the input's zero point, negative below it
+int32_t Adc_to_ma(Adc_Channel_t channel, uint16_t counts_q6) {
+    if (channel >= SENSE_COUNT) return 0;
+    return (((int32_t)counts_q6 - zero_q6[channel]) * scale_q8[channel]) >> (ADC_FRAC_BITS + 8);
+}
+
+int32_t Adc_get_ma(Adc_Channel_t channel) {
+    return Adc_to_ma(channel, Adc_get_filtered(channel));
+}
+
+// Zero points in Q6 counts: the board value and the one in use
+uint16_t Adc_get_nominal_zero(Adc_Channel_t channel) {
+    if (channel >= SENSE_COUNT) return 0;
+    return nominal_q6[channel];
+}
+
+uint16_t Adc_get_zero(Adc_Channel_t channel) {
+    if (channel >= SENSE_COUNT) return 0;
+    return zero_q6[channel];
+}
+
+void Adc_set_zero(Adc_Channel_t channel, uint16_t zero) {
+    if (channel >= SENSE_COUNT) return;
+    zero_q6[channel] = zero;
+}
+
+// mA above the zero point to Q6 counts, saturating
+uint16_t Adc_from_ma(Adc_Channel_t channel, uint16_t ma) {
+    uint32_t counts_q6;
+
+    if (channel >= SENSE_COUNT) return 0xFFFF;
+    counts_q6 = zero_q6[channel] + ((uint32_t)ma << (ADC_FRAC_BITS + 8)) / scale_q8[channel];
+    return (counts_q6 > 0xFFFF) ? 0xFFFF : (uint16_t)counts_q6;
+}
+
+uint16_t Adc_get_limit_ma(Adc_Channel_t channel) {
+    if (channel >= SENSE_COUNT) return 0;
+    return limit_ma[channel];
+}
+
+uint16_t Adc_get_coils(Adc_Channel_t channel) {
+    if (channel >= SENSE_COUNT) return 0;
+    return coils[channel];
+}
+
+// One frame per input: index, mA (clamped at 0), filtered Q6, last sample
+void Adc_fill_frame(uint8_t entry, uint8_t *data) {
+    int32_t ma = Adc_get_ma((Adc_Channel_t)entry);
+    uint16_t clamped = (ma < 0) ? 0 : (ma > 0xFFFF) ? 0xFFFF : (uint16_t)ma;
+    uint16_t f = Adc_get_filtered((Adc_Channel_t)entry);
+    uint16_t r = Adc_get_raw((Adc_Channel_t)entry);
+
+    data[0] = entry;
+    data[1] = (uint8_t)clamped;
+    data[2] = (uint8_t)(clamped >> 8);
+    data[3] = (uint8_t)f;
+    data[4] = (uint8_t)(f >> 8);
+    data[5] = (uint8_t)r;
+    data[6] = (uint8_t)(r >> 8);
+}
@@ -0,0 +1,32 @@
+#ifndef ADC_SCAN_H
+#define ADC_SCAN_H
+
+#include "common.h"
+#include "config.h"
+#include "board.h"
+
+#define ADC_FRAC_BITS 6  // Filtered results are counts in Q6
+
+#define ADC_ENTRY_ENUM(name, ...) name,
+
+typedef enum {
+    BOARD_ADC_LIST(ADC_ENTRY_ENUM)
+    SENSE_COUNT
+} Adc_Channel_t;
+
+void Adc_init(void);
+uint16_t Adc_get_raw(Adc_Channel_t channel);
+uint16_t Adc_get_filtered(Adc_Channel_t channel);
+int32_t Adc_to_ma(Adc_Channel_t channel, uint16_t counts_q6);
+int32_t Adc_get_ma(Adc_Channel_t channel);
+uint16_t Adc_from_ma(Adc_Channel_t channel, uint16_t ma);
+uint16_t Adc_get_nominal_zero(Adc_Channel_t channel);
+uint16_t Adc_get_zero(Adc_Channel_t channel);
+void Adc_set_zero(Adc_Channel_t channel, uint16_t zero);
+uint16_t Adc_get_limit_ma(Adc_Channel_t channel);
+uint16_t Adc_get_coils(Adc_Channel_t channel);
+void Adc_fill_frame(uint8_t entry, uint8_t *data);
+
+#define ADC_TELEMETRY_ENTRIES SENSE_COUNT
+
+#endif // ADC_SCAN_H
@@ -0,0 +1,215 @@
+#include "benchmark.h"
+
+#if BENCHMARK_ENABLED
+
+#include "can.h"
+#include "can_lookup.h"
+#include "solenoid.h"
+#include "profiler.h"
+#include "debug.h"
+
+// Blocking debug prints inside the measured calls would dominate the timings
+_Static_assert(!DEBUG_ENABLED, "BENCHMARK_ENABLED needs DEBUG_ENABLED 0");
+
+typedef enum {
+    SET_LOOKUP = 0,  // One frame per lookup table entry, cycled
+    SET_RANDOM,      // xorshift payloads, fixed seed
+#ifdef HOST_BENCH
+    SET_RECORDED,    // Recorded bus traffic, host only, cycled
+#endif
+    SET_COUNT
+} Bench_Set_t;
+
+static const char *const set_names[SET_COUNT] = {
+    "lookup",
+    "random",
+#ifdef HOST_BENCH
+    "recorded",
+#endif
+};
+
+typedef enum {
+    BENCH_GET_FUNCTION = 0,
+    BENCH_DECODE,
+    BENCH_EXTRACT,
+    BENCH_SET_PIN_STATE,
+    BENCH_APPLY_EDGES,
+    BENCH_SET_OUTPUT,
+    BENCH_COUNT
+} Bench_Case_t;
+
+static const char *const case_names[BENCH_COUNT] = {
+    "CAN_get_function_from_data",
+    "CAN_decode_functions",
+    "CAN_extract",
+    "Sol_set_pin_state",
+    "Sol_apply_edges",
+    "Sol_set_output",
+};
+
+static uint16_t rng_state;
+
+static uint16_t rng_next(void) {
+    rng_state ^= rng_state << 7;
+    rng_state ^= rng_state >> 9;
+    rng_state ^= rng_state << 8;
+    return rng_state;
+}
+
+static void make_frame(Bench_Set_t set, uint16_t n, CAN_Message_t *msg) {
+#ifdef HOST_BENCH
+    if (set == SET_RECORDED) {
+        Bench_recorded_frame(n, msg);
+        return;
+    }
+#endif
+    msg->id = CAN_MSG_ID;
+    msg->length = 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        msg->data[i] = 0;
+    }
+    if (set == SET_LOOKUP) {
+        const CAN_Lookup_Entry_t *entry = &can_lookup_table[n % FUNCTION_COUNT];
+        msg->data[entry->byte_index] = entry->value;
+    } else {
+        for (uint8_t i = 0; i < 8; i += 2) {
+            uint16_t r = rng_next();
+            msg->data[i] = (uint8_t)r;
+            msg->data[i + 1] = (uint8_t)(r >> 8);
+        }
+    }
+}
+
+// Timer3 ticks spent in one call of the case, frame already generated
+static uint32_t run_case(Bench_Case_t bench, const CAN_Message_t *msg, uint16_t *prev) {
+    CAN_Message_t out;
+    uint16_t signals = CAN_decode_functions(msg->data);
+    uint32_t start;
+    uint32_t ticks;
+
+    switch (bench) {
+        case BENCH_GET_FUNCTION:
+            // Per-byte lookup as the decoder used before CAN_decode_functions
+            start = Profile_now();
+            for (uint8_t i = 0; i < 8; i++) {
+                if (msg->data[i]) {
+                    (void)CAN_get_function_from_data(i, msg->data[i]);
+                }
+            }
+            ticks = Profile_now() - start;
+            break;
+        case BENCH_DECODE:
+            start = Profile_now();
+            signals = CAN_decode_functions(msg->data);
+            ticks = Profile_now() - start;
+            break;
+        case BENCH_EXTRACT:
+            CAN_inject(msg);
+            start = Profile_now();
+            CAN_extract(&out);
+            ticks = Profile_now() - start;
+            break;
+        case BENCH_SET_PIN_STATE:
+            // On then off for every decoded function, never committed to the ports
+            start = Profile_now();
+            for (uint8_t i = 0; i < FUNCTION_COUNT; i++) {
+                if (signals & (1 << i)) {
+                    Sol_set_pin_state((Function_t)i, true);
+                    Sol_set_pin_state((Function_t)i, false);
+                }
+            }
+            ticks = Profile_now() - start;
+            break;
+        case BENCH_APPLY_EDGES: {
+            uint16_t changed = signals ^ *prev;
+            start = Profile_now();
+            Sol_apply_edges(signals & changed, *prev & changed);
+            ticks = Profile_now() - start;
+            *prev = signals;
+            break;
+        }
+        default:
+            // Outputs are all off here, the ports are rewritten with zeros
+            start = Profile_now();
+            Sol_set_output();
+            ticks = Profile_now() - start;
+            break;
+    }
+    return ticks;
+}
+
+static void print_result(Bench_Case_t bench, Bench_Set_t set, uint32_t ticks, bool first) {
+    if (!first) {
+        debug_println(",");
+    }
+    debug_print("  {\"name\":\"");
+    debug_print(case_names[bench]);
+    debug_print("\",\"set\":\"");
+    debug_print(set_names[set]);
+    debug_print("\",\"frames\":");
+    debug_print_number(BENCH_FRAMES);
+    debug_print(",\"ns_per_frame\":");
+    debug_print_number(ticks * PROFILE_TICK_NS / BENCH_FRAMES);
+    debug_print("}");
+}
+
+/**
+ * @brief Time the decode, interlock and output paths over generated payload
+ *        sets and print one JSON document on the debug UART. Runs once at
+ *        start-up, before the watchdog and with every output off. The host
+ *        build (make -C host bench) adds recorded traffic and times on the
+ *        host clock.
+ */
+void Bench_run(void) {
+    CAN_Message_t msg;
+    uint32_t overhead;
+    bool first = true;
+
+    // Cost of the two timer reads around every measurement, the cheapest of
+    // a few so a stray interrupt or cache miss does not inflate it
+    overhead = UINT32_MAX;
+    for (uint8_t i = 0; i < 16; i++) {
+        uint32_t start = Profile_now();
+        uint32_t ticks = Profile_now() - start;
+        if (ticks < overhead) overhead = ticks;
+    }
+
+    debug_println("{\"benchmark\":{");
+#ifdef HOST_BENCH
+    debug_print("  \"clock\":\"host\"");
+#else
+    debug_print("  \"f_cpu\":");
+    debug_print_number(F_CPU);
+#endif
+    debug_println(",\"results\":[");
+
+    for (uint8_t bench = 0; bench < BENCH_COUNT; bench++) {
+        for (uint8_t set = 0; set < SET_COUNT; set++) {
+            uint32_t total = 0;
+            uint16_t prev = 0;
+
+#ifdef HOST_BENCH
+            if (set == SET_RECORDED && Bench_recorded_count() == 0) {
+                continue;  // No log given
+            }
+#endif
+            rng_state = 0xACE1;
+            Sol_all_off();
+            for (uint16_t n = 0; n < BENCH_FRAMES; n++) {
+                uint32_t ticks;
+                make_frame((Bench_Set_t)set, n, &msg);
+                ticks = run_case((Bench_Case_t)bench, &msg, &prev);
+                total += (ticks > overhead) ? ticks - overhead : 0;
+            }
+            Sol_all_off();
+            print_result((Bench_Case_t)bench, (Bench_Set_t)set, total, first);
+            first = false;
+        }
+    }
+
+    Sol_set_output();
+    debug_println("");
+    debug_println("]}}");
+}
+
+#endif // BENCHMARK_ENABLED
@@ -0,0 +1,21 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "common.h"
+#include "config.h"
+
+#if BENCHMARK_ENABLED
+void Bench_run(void);
+
+#ifdef HOST_BENCH
+#include "can.h"
+
+// Command frames from a candump log, loaded by host/bench.c
+uint16_t Bench_recorded_count(void);
+void Bench_recorded_frame(uint16_t n, CAN_Message_t *msg);
+#endif
+#else
+static inline void Bench_run(void) {}
+#endif
+
+#endif // BENCHMARK_H
@@ -0,0 +1,114 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <avr/io.h>
+#include "config.h"
+
+/*
+ * Board description, the single place where pins are assigned.
+ * Each entry is X(name, port letter, bit). Users expand the lists with the
+ * BOARD_* helpers below so every access compiles to a constant sbi/cbi or
+ * PINx write when the index is known at compile time.
+ */
+
+// Status LEDs (LED.c)
+#define BOARD_LED_LIST(X) \
+    X(LED_POWER,  C, 5) \
+    X(LED_CAN,    B, 0) \
+    X(LED_OUTPUT, B, 3) \
+    X(LED_MODE,   B, 6)
+
+// RGB status LEDs (LED_ctrl.c)
+#define BOARD_RGB_LED_LIST(X) \
+    X(LED1_RED,   C, 4) \
+    X(LED1_GREEN, C, 5) \
+    X(LED1_BLUE,  C, 6) \
+    X(LED2_RED,   B, 0) \
+    X(LED2_GREEN, B, 1) \
+    X(LED2_BLUE,  B, 2) \
+    X(LED3_RED,   B, 3) \
+    X(LED3_GREEN, B, 4) \
+    X(LED3_BLUE,  B, 5) \
+    X(LED4_RED,   B, 6) \
+    X(LED4_GREEN, B, 7) \
+    X(LED4_BLUE,  G, 0)
+
+// Solenoid outputs, named by function letter and listed pairwise
+// (C/D, E/F, G/H, M/N, A/P, J/L) in FUNCTION_* / SOL_* order
+#define BOARD_SOLENOID_LIST(X) \
+    X(C, A, 0) \
+    X(D, A, 1) \
+    X(E, A, 2) \
+    X(F, A, 3) \
+    X(G, A, 4) \
+    X(H, A, 5) \
+    X(M, A, 6) \
+    X(N, A, 7) \
+    X(A, C, 0) \
+    X(P, C, 1) \
+    X(J, C, 2) \
+    X(L, C, 3)
+
+// Both solenoid lists are enumerated pairwise: pair p is bits 2p/2p+1 of
+// an output bitmap and a coil's partner is the neighbouring bit
+#define BOARD_PAIR_MASK(pair) ((uint16_t)0x3 << (2 * (pair)))
+#define BOARD_PAIR_FIRST 0x5555
+#define BOARD_PAIR_PARTNERS(bits) \
+    ((uint16_t)((((bits) & BOARD_PAIR_FIRST) << 1) | (((bits) >> 1) & BOARD_PAIR_FIRST)))
+
+// Current sense inputs on port F, scanned by adc_scan.c. Each entry is
+// X(name, ADC channel, mA per count in Q8, zero count, limit mA, coils)
+// where coils is the output bitmap whose current the input carries
+#define BOARD_ACS712_MA_Q8 \
+    ((uint32_t)(ADC_REF_VOLTAGE * 256000.0 / ADC_RESOLUTION / CURRENT_SENSOR_SENSITIVITY))
+#define BOARD_SHUNT_MA_Q8(milliohm, gain) \
+    ((uint32_t)(ADC_REF_VOLTAGE * 256000000.0 / ADC_RESOLUTION / ((milliohm) * (gain))))
+
+#if BOARD_BANK_SENSE
+// ACS712 on the supply plus a 10 mOhm shunt with x20 amplifier per port bank
+#define BOARD_ADC_LIST(X) \
+    X(SENSE_TOTAL,  CURRENT_SENSOR_ADC_CHANNEL, BOARD_ACS712_MA_Q8, CURRENT_SENSOR_ZERO_POINT, MAX_TOTAL_CURRENT, 0x0FFF) \
+    X(SENSE_BANK_A, 2, BOARD_SHUNT_MA_Q8(10, 20), 0, MAX_BANK_CURRENT, 0x00FF) \
+    X(SENSE_BANK_C, 3, BOARD_SHUNT_MA_Q8(10, 20), 0, MAX_BANK_CURRENT, 0x0F00)
+#else
+#define BOARD_ADC_LIST(X) \
+    X(SENSE_TOTAL,  CURRENT_SENSOR_ADC_CHANNEL, BOARD_ACS712_MA_Q8, CURRENT_SENSOR_ZERO_POINT, MAX_TOTAL_CURRENT, 0x0FFF)
+#endif
+
+// Expansion helpers
+#define BOARD_ENUM(name, port, bit)          name,
+#define BOARD_SET_OUTPUT(name, port, bit)    DDR##port |= (1 << (bit));
+#define BOARD_CLEAR(name, port, bit)         PORT##port &= ~(1 << (bit));
+#define BOARD_CASE_WRITE(name, port, bit) \
+    case name: \
+        if (on) PORT##port |= (1 << (bit)); \
+        else PORT##port &= ~(1 << (bit)); \
+        break;
+#define BOARD_CASE_TOGGLE(name, port, bit) \
+    case name: PIN##port = (1 << (bit)); break;
+
+// Compile-time check for pins assigned twice: the sum of one-hot pin
+// masks only equals their OR when every pin is distinct
+#define BOARD_PORT_INDEX_A 0
+#define BOARD_PORT_INDEX_B 1
+#define BOARD_PORT_INDEX_C 2
+#define BOARD_PORT_INDEX_D 3
+#define BOARD_PORT_INDEX_E 4
+#define BOARD_PORT_INDEX_F 5
+#define BOARD_PORT_INDEX_G 6
+#define BOARD_PIN_MASK(port, bit) (1ULL << (BOARD_PORT_INDEX_##port * 8 + (bit)))
+#define BOARD_PIN_SUM(name, port, bit) + BOARD_PIN_MASK(port, bit)
+#define BOARD_PIN_OR(name, port, bit)  | BOARD_PIN_MASK(port, bit)
+#define BOARD_ADC_PIN_SUM(name, ch, ...) + BOARD_PIN_MASK(F, ch)
+#define BOARD_ADC_PIN_OR(name, ch, ...)  | BOARD_PIN_MASK(F, ch)
+
+_Static_assert((0 BOARD_LED_LIST(BOARD_PIN_SUM) BOARD_SOLENOID_LIST(BOARD_PIN_SUM)) ==
+               (0 BOARD_LED_LIST(BOARD_PIN_OR) BOARD_SOLENOID_LIST(BOARD_PIN_OR)),
+               "Duplicate pin in BOARD_LED_LIST / BOARD_SOLENOID_LIST");
+_Static_assert((0 BOARD_RGB_LED_LIST(BOARD_PIN_SUM) BOARD_SOLENOID_LIST(BOARD_PIN_SUM)) ==
+               (0 BOARD_RGB_LED_LIST(BOARD_PIN_OR) BOARD_SOLENOID_LIST(BOARD_PIN_OR)),
+               "Duplicate pin in BOARD_RGB_LED_LIST / BOARD_SOLENOID_LIST");
+_Static_assert((0 BOARD_ADC_LIST(BOARD_ADC_PIN_SUM)) == (0 BOARD_ADC_LIST(BOARD_ADC_PIN_OR)),
+               "Duplicate channel in BOARD_ADC_LIST");
+
+#endif // BOARD_H
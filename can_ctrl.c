@@ -9,12 +9,26 @@
 #include "error_handler.h"
 #include "LED_ctrl.h"
 #include "eeprom_ctrl.h"
+#include "can_timing.h"
 #include <avr/interrupt.h>
 #include <avr/io.h>
 
 // Default CAN ID to filter
 #define DEFAULT_CAN_ID 0x14FFFFB0
 
+CAN_TIMING_DEFINE(CAN_TIMING_125K, 125000);
+CAN_TIMING_DEFINE(CAN_TIMING_250K, 250000);
+CAN_TIMING_DEFINE(CAN_TIMING_500K, 500000);
+CAN_TIMING_DEFINE(CAN_TIMING_1M, 1000000);
+
+// CANBT1..3 per EEPROM baud index: 125k, 250k, 500k, 1M
+static const uint8_t can_bit_timing[][3] = {
+    CAN_TIMING_REGS(CAN_TIMING_125K),
+    CAN_TIMING_REGS(CAN_TIMING_250K),
+    CAN_TIMING_REGS(CAN_TIMING_500K),
+    CAN_TIMING_REGS(CAN_TIMING_1M),
+};
+
 // Macro to extract bit from byte
 #define BIT_IS_SET(byte, bit) (((byte) >> (bit)) & 0x01)
 
@@ -47,34 +61,13 @@ void CAN_Init(void)
     // Reset CAN controller
     CANGCON |= (1 << SWRES);
     
-    // Set baud rate (250kbps @ 16MHz - default)
-    switch (baud_rate) {
-        case 0: // 125 kbps
-            CANBT1 = 0x0E;
-            CANBT2 = 0x0C;
-            CANBT3 = 0x37;
-            break;
-        case 1: // 250 kbps
-            CANBT1 = 0x06;
-            CANBT2 = 0x0C;
-            CANBT3 = 0x37;
-            break;
-        case 2: // 500 kbps
-            CANBT1 = 0x02;
-            CANBT2 = 0x0C;
-            CANBT3 = 0x37;
-            break;
-        case 3: // 1 Mbps
-            CANBT1 = 0x00;
-            CANBT2 = 0x0C;
-            CANBT3 = 0x37;
-            break;
-        default: // Default to 250 kbps
-            CANBT1 = 0x06;
-            CANBT2 = 0x0C;
-            CANBT3 = 0x37;
-            break;
+    // Set baud rate, 250 kbps by default
+    if (baud_rate >= sizeof(can_bit_timing) / sizeof(can_bit_timing[0])) {
+        baud_rate = 1;
     }
+    CANBT1 = can_bit_timing[baud_rate][0];
+    CANBT2 = can_bit_timing[baud_rate][1];
+    CANBT3 = can_bit_timing[baud_rate][2];
     
     // Enable CAN interrupts
     CANGIE = (1 << ENIT) | (1 << ENRX);
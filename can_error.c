@@ -0,0 +1,153 @@
+#include "can_error.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "soft_timer.h"
+#include "debug.h"
+
+#define CAN_ERROR_FLAGS ((1 << BOFFIT) | (1 << SERG) | (1 << CERG) | (1 << FERG) | (1 << AERG))
+
+static volatile CAN_Error_Stats_t err_stats;
+static volatile CAN_State_t can_state = CAN_STATE_ACTIVE;
+static volatile bool fault_pending = false;
+static volatile bool recovering = false;
+static uint16_t backoff_ms = CAN_BUSOFF_BACKOFF_MIN_MS;
+static Soft_Timer_t recovery_timer;
+
+// Runs twice per bus-off: first to rejoin after the backoff, then to
+// forget the backoff once the bus has stayed up for CAN_BUSOFF_STABLE_MS
+static void recovery_step(void *arg) {
+    (void)arg;
+    if (recovering) {
+        // The controller rejoins after 128 x 11 recessive bits
+        CANGCON = (1 << ENASTB);
+        recovering = false;
+        Timer_arm(&recovery_timer, CAN_BUSOFF_STABLE_MS, 0);
+    } else {
+        backoff_ms = CAN_BUSOFF_BACKOFF_MIN_MS;
+    }
+}
+
+// Caller must have interrupts disabled
+static void update_state(void) {
+    uint8_t gsta = CANGSTA;
+    CAN_State_t next = CAN_STATE_ACTIVE;
+
+    if (gsta & (1 << BOFF)) {
+        next = CAN_STATE_BUS_OFF;
+    } else if (gsta & (1 << ERRP)) {
+        next = CAN_STATE_PASSIVE;
+    }
+    if (next == CAN_STATE_PASSIVE && can_state == CAN_STATE_ACTIVE) {
+        err_stats.error_passive++;
+    }
+    can_state = next;
+}
+
+void CAN_error_init(void) {
+    Timer_setup(&recovery_timer, recovery_step, NULL);
+    backoff_ms = CAN_BUSOFF_BACKOFF_MIN_MS;
+    recovering = false;
+    can_state = CAN_STATE_ACTIVE;
+}
+
+// Called from the CAN ISR before the general interrupt flags are cleared
+void CAN_error_interrupt(void) {
+    uint8_t flags = CANGIT & CAN_ERROR_FLAGS;
+
+    if (flags & (1 << SERG)) err_stats.stuff++;
+    if (flags & (1 << CERG)) err_stats.crc++;
+    if (flags & (1 << FERG)) err_stats.form++;
+    if (flags & (1 << AERG)) err_stats.ack++;
+
+    if (flags & (1 << BOFFIT)) {
+        err_stats.bus_off++;
+        fault_pending = true;
+
+        // Hold the controller off the bus for the backoff, then retry
+        CANGCON = 0;
+        recovering = true;
+        Timer_arm(&recovery_timer, backoff_ms, 0);
+        backoff_ms = (backoff_ms >= CAN_BUSOFF_BACKOFF_MAX_MS / 2) ?
+                     CAN_BUSOFF_BACKOFF_MAX_MS : backoff_ms * 2;
+    }
+
+    // Write-one-to-clear
+    CANGIT = flags;
+    update_state();
+}
+
+// Error-passive has no interrupt of its own, poll it from the main loop
+void CAN_error_update(void) {
+    cli();
+    update_state();
+    sei();
+}
+
+bool CAN_error_take_fault(void) {
+    bool fault;
+
+    cli();
+    fault = fault_pending;
+    fault_pending = false;
+    sei();
+
+    if (fault) {
+        DEBUG_PRINTLN("CAN bus-off, recovery scheduled");
+    }
+    return fault;
+}
+
+CAN_State_t CAN_error_get_state(void) {
+    return can_state;
+}
+
+void CAN_error_get_stats(CAN_Error_Stats_t *stats) {
+    cli();
+    stats->bus_off = err_stats.bus_off;
+    stats->error_passive = err_stats.error_passive;
+    stats->stuff = err_stats.stuff;
+    stats->crc = err_stats.crc;
+    stats->form = err_stats.form;
+    stats->ack = err_stats.ack;
+    sei();
+}
+
+// Entry 0: state, TEC, REC, bus-off
+// Entry 1: stuff, CRC, form errors
+// Entry 2: ack errors, current backoff in ms, error passive
+void CAN_error_fill_frame(uint8_t entry, uint8_t *data) {
+    CAN_Error_Stats_t stats;
+    uint16_t backoff;
+
+    CAN_error_get_stats(&stats);
+    cli();
+    backoff = backoff_ms;
+    sei();
+
+    data[0] = entry;
+    switch (entry) {
+        case 0:
+            data[1] = (uint8_t)can_state;
+            data[2] = CANTEC;
+            data[3] = CANREC;
+            data[4] = (uint8_t)stats.bus_off;
+            data[5] = (uint8_t)(stats.bus_off >> 8);
+            break;
+        case 1:
+            data[1] = (uint8_t)stats.stuff;
+            data[2] = (uint8_t)(stats.stuff >> 8);
+            data[3] = (uint8_t)stats.crc;
+            data[4] = (uint8_t)(stats.crc >> 8);
+            data[5] = (uint8_t)stats.form;
+            data[6] = (uint8_t)(stats.form >> 8);
+            break;
+        default:
+            data[1] = (uint8_t)stats.ack;
+            data[2] = (uint8_t)(stats.ack >> 8);
+            data[3] = (uint8_t)backoff;
+            data[4] = (uint8_t)(backoff >> 8);
+            data[5] = (uint8_t)stats.error_passive;
+            data[6] = (uint8_t)(stats.error_passive >> 8);
+            break;
+    }
+}
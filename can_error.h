@@ -0,0 +1,33 @@
+#ifndef CAN_ERROR_H
+#define CAN_ERROR_H
+
+#include "common.h"
+#include "config.h"
+
+// Fault confinement state as reported by CANGSTA
+typedef enum {
+    CAN_STATE_ACTIVE = 0,
+    CAN_STATE_PASSIVE,
+    CAN_STATE_BUS_OFF
+} CAN_State_t;
+
+typedef struct {
+    uint16_t bus_off;        // Bus-off entries
+    uint16_t error_passive;  // Error-passive entries
+    uint16_t stuff;          // Error frames by cause, from CANGIT
+    uint16_t crc;
+    uint16_t form;
+    uint16_t ack;
+} CAN_Error_Stats_t;
+
+#define CAN_ERROR_TELEMETRY_ENTRIES 3
+
+void CAN_error_init(void);
+void CAN_error_interrupt(void);
+void CAN_error_update(void);
+bool CAN_error_take_fault(void);
+CAN_State_t CAN_error_get_state(void);
+void CAN_error_get_stats(CAN_Error_Stats_t *stats);
+void CAN_error_fill_frame(uint8_t entry, uint8_t *data);
+
+#endif // CAN_ERROR_H
@@ -1,18 +1,32 @@
 #include "can_lookup.h"
 
+// X(byte_index, value, function, pair, duty_index)
+// A proportional function takes its duty from a spare frame byte (0, 1, 4
+// or 5) instead of its signal bit, e.g. X(4, 0x00, FUNCTION_J, PAIR_6, 4)
+#define CAN_LOOKUP_LIST(X) \
+    X(2, 0x04, FUNCTION_C, PAIR_1, CAN_NO_DUTY) \
+    X(2, 0x01, FUNCTION_D, PAIR_1, CAN_NO_DUTY) \
+    X(3, 0x01, FUNCTION_E, PAIR_2, CAN_NO_DUTY) \
+    X(3, 0x02, FUNCTION_F, PAIR_2, CAN_NO_DUTY) \
+    X(3, 0x04, FUNCTION_G, PAIR_3, CAN_NO_DUTY) \
+    X(3, 0x08, FUNCTION_H, PAIR_3, CAN_NO_DUTY) \
+    X(6, 0x40, FUNCTION_M, PAIR_4, CAN_NO_DUTY) \
+    X(6, 0x10, FUNCTION_N, PAIR_4, CAN_NO_DUTY) \
+    X(6, 0x04, FUNCTION_A, PAIR_5, CAN_NO_DUTY) \
+    X(6, 0x01, FUNCTION_P, PAIR_5, CAN_NO_DUTY) \
+    X(2, 0x40, FUNCTION_J, PAIR_6, CAN_NO_DUTY) \
+    X(2, 0x10, FUNCTION_L, PAIR_6, CAN_NO_DUTY)
+
+#define CAN_LOOKUP_ENTRY(byte_index, value, function, pair, duty_index) \
+    [function] = {byte_index, value, function, pair, duty_index},
+#define CAN_LOOKUP_CHECK(byte_index, value, function, pair, duty_index) \
+    _Static_assert((function) / 2 == (pair), #function " is not in " #pair);
+
+// The interlock treats bits 2p/2p+1 of the output bitmap as pair p
+CAN_LOOKUP_LIST(CAN_LOOKUP_CHECK)
+
 const CAN_Lookup_Entry_t can_lookup_table[FUNCTION_COUNT] = {
-    {2, 0x04, FUNCTION_C, PAIR_1},
-    {2, 0x01, FUNCTION_D, PAIR_1},
-    {3, 0x01, FUNCTION_E, PAIR_2},
-    {3, 0x02, FUNCTION_F, PAIR_2},
-    {3, 0x04, FUNCTION_G, PAIR_3},
-    {3, 0x08, FUNCTION_H, PAIR_3},
-    {6, 0x40, FUNCTION_M, PAIR_4},
-    {6, 0x10, FUNCTION_N, PAIR_4},
-    {6, 0x04, FUNCTION_A, PAIR_5},
-    {6, 0x01, FUNCTION_P, PAIR_5},
-    {2, 0x40, FUNCTION_J, PAIR_6},
-    {2, 0x10, FUNCTION_L, PAIR_6}
+    CAN_LOOKUP_LIST(CAN_LOOKUP_ENTRY)
 };
 
 Function_t CAN_get_function_from_data(uint8_t byte_index, uint8_t value) {
@@ -29,3 +43,36 @@ Pair_t CAN_get_pair_for_function(Function_t function) {
     if (function >= FUNCTION_COUNT) return PAIR_COUNT;
     return can_lookup_table[function].pair;
 }
+
+// One bit per Function_t, set when the function's signal bit (or duty) is set in the frame
+uint16_t CAN_decode_functions(const uint8_t *data) {
+    uint16_t signals = 0;
+    for (uint8_t i = 0; i < FUNCTION_COUNT; i++) {
+        const CAN_Lookup_Entry_t *entry = &can_lookup_table[i];
+        uint8_t active = (entry->duty_index != CAN_NO_DUTY) ?
+            data[entry->duty_index] : (data[entry->byte_index] & entry->value);
+        if (active) {
+            signals |= (1 << entry->function);
+        }
+    }
+    return signals;
+}
+
+// One bit per proportional Function_t
+uint16_t CAN_get_duty_mask(void) {
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < FUNCTION_COUNT; i++) {
+        if (can_lookup_table[i].duty_index != CAN_NO_DUTY) {
+            mask |= (1 << can_lookup_table[i].function);
+        }
+    }
+    return mask;
+}
+
+// Commanded duty 0-255, on/off functions read as full duty
+uint8_t CAN_decode_duty(const uint8_t *data, Function_t function) {
+    if (function >= FUNCTION_COUNT || can_lookup_table[function].duty_index == CAN_NO_DUTY) {
+        return 0xFF;
+    }
+    return data[can_lookup_table[function].duty_index];
+}
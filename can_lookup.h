@@ -2,20 +2,12 @@
 #define CAN_LOOKUP_H
 
 #include "common.h"
+#include "board.h"
 
+// Functions follow BOARD_SOLENOID_LIST, so function 2p/2p+1 is pair p
+#define FUNCTION_ENUM(name, port, bit) FUNCTION_##name,
 typedef enum {
-    FUNCTION_C = 0,
-    FUNCTION_D,
-    FUNCTION_E,
-    FUNCTION_F,
-    FUNCTION_G,
-    FUNCTION_H,
-    FUNCTION_M,
-    FUNCTION_N,
-    FUNCTION_A,
-    FUNCTION_P,
-    FUNCTION_J,
-    FUNCTION_L,
+    BOARD_SOLENOID_LIST(FUNCTION_ENUM)
     FUNCTION_COUNT
 } Function_t;
 
@@ -29,16 +21,24 @@ typedef enum {
     PAIR_COUNT
 } Pair_t;
 
+_Static_assert(FUNCTION_COUNT == 2 * PAIR_COUNT, "Every pair needs two functions");
+
+#define CAN_NO_DUTY 0xFF  // duty_index of an on/off function
+
 typedef struct {
     uint8_t byte_index;
     uint8_t value;
     Function_t function;
     Pair_t pair;
+    uint8_t duty_index;  // Frame byte holding an 8-bit duty, signal is duty != 0
 } CAN_Lookup_Entry_t;
 
 extern const CAN_Lookup_Entry_t can_lookup_table[FUNCTION_COUNT];
 
 Function_t CAN_get_function_from_data(uint8_t byte_index, uint8_t value);
 Pair_t CAN_get_pair_for_function(Function_t function);
+uint16_t CAN_decode_functions(const uint8_t *data);
+uint16_t CAN_get_duty_mask(void);
+uint8_t CAN_decode_duty(const uint8_t *data, Function_t function);
 
 #endif // CAN_LOOKUP_H
\ No newline at end of file
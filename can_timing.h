@@ -0,0 +1,54 @@
+#ifndef CAN_TIMING_H
+#define CAN_TIMING_H
+
+#include "config.h"
+
+/*
+ * CAN bit timing computed at compile time from F_CPU, the bit rate,
+ * CAN_SAMPLE_POINT and CAN_SJW. The longest bit (most time quanta, 8..25)
+ * with an integer prescaler wins; PHS1 follows PHS2 unless PRS would
+ * exceed 8 Tq. Missing solutions fail the build instead of running the
+ * bus at a slightly wrong rate.
+ */
+
+#define CAN_TQ_FITS(rate, tq) \
+    ((F_CPU % ((unsigned long)(rate) * (tq))) == 0 && \
+     (F_CPU / ((unsigned long)(rate) * (tq))) <= 64)
+
+#define CAN_TQ_SEARCH(rate) ( \
+    CAN_TQ_FITS(rate, 25) ? 25 : CAN_TQ_FITS(rate, 24) ? 24 : \
+    CAN_TQ_FITS(rate, 23) ? 23 : CAN_TQ_FITS(rate, 22) ? 22 : \
+    CAN_TQ_FITS(rate, 21) ? 21 : CAN_TQ_FITS(rate, 20) ? 20 : \
+    CAN_TQ_FITS(rate, 19) ? 19 : CAN_TQ_FITS(rate, 18) ? 18 : \
+    CAN_TQ_FITS(rate, 17) ? 17 : CAN_TQ_FITS(rate, 16) ? 16 : \
+    CAN_TQ_FITS(rate, 15) ? 15 : CAN_TQ_FITS(rate, 14) ? 14 : \
+    CAN_TQ_FITS(rate, 13) ? 13 : CAN_TQ_FITS(rate, 12) ? 12 : \
+    CAN_TQ_FITS(rate, 11) ? 11 : CAN_TQ_FITS(rate, 10) ? 10 : \
+    CAN_TQ_FITS(rate, 9) ? 9 : CAN_TQ_FITS(rate, 8) ? 8 : 0)
+
+// Segment lengths in Tq as enum constants name##_TQ, _BRP, _PRS, _PHS1, _PHS2
+#define CAN_TIMING_DEFINE(name, rate) \
+    enum { \
+        name##_TQ = CAN_TQ_SEARCH(rate), \
+        name##_BRP = F_CPU / ((unsigned long)(rate) * (name##_TQ ? name##_TQ : 1)), \
+        name##_PHS2 = name##_TQ - (name##_TQ * CAN_SAMPLE_POINT + 500) / 1000, \
+        name##_REST = name##_TQ - 1 - name##_PHS2, \
+        name##_PHS1 = (name##_REST - 8 > name##_PHS2) ? name##_REST - 8 : name##_PHS2, \
+        name##_PRS = name##_REST - name##_PHS1 \
+    }; \
+    _Static_assert(name##_TQ != 0, "No exact CAN bit timing for " #rate " at F_CPU"); \
+    _Static_assert(name##_PRS >= 1 && name##_PRS <= 8 && \
+                   name##_PHS1 >= 1 && name##_PHS1 <= 8 && \
+                   name##_PHS2 >= 2 && name##_PHS2 <= 8, \
+                   "CAN_SAMPLE_POINT not reachable at " #rate); \
+    _Static_assert(CAN_SJW >= 1 && CAN_SJW <= 4 && \
+                   CAN_SJW <= name##_PHS1 && CAN_SJW <= name##_PHS2, \
+                   "CAN_SJW too long for " #rate)
+
+// CANBT1..3 initialiser; triple sampling needs a prescaler above 1
+#define CAN_TIMING_REGS(name) { \
+    (uint8_t)((name##_BRP - 1) << 1), \
+    (uint8_t)(((CAN_SJW - 1) << 5) | ((name##_PRS - 1) << 1)), \
+    (uint8_t)(((name##_PHS2 - 1) << 4) | ((name##_PHS1 - 1) << 1) | (name##_BRP > 1 ? 1 : 0)) }
+
+#endif // CAN_TIMING_H
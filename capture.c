@@ -0,0 +1,274 @@
+#include "capture.h"
+
+#if CAPTURE_ENABLED
+
+#include <avr/interrupt.h>
+#include "adc_scan.h"
+#include "can.h"
+#include "j1939.h"
+#include "soft_timer.h"
+#include "debug.h"
+
+/*
+ * Pre/post trigger recorder for one sense input, fed from the ADC ISR.
+ * While armed the ring keeps the newest samples. A trigger keeps up to
+ * CAPTURE_PRE_TRIGGER of them, records the rest, then freezes until the
+ * capture has been downloaded over CAN. The UART dump is informational
+ * and leaves the capture in place.
+ */
+#define CAPTURE_SAMPLE_US (1000000UL * SENSE_COUNT / ADC_SCAN_RATE_HZ)
+#define CAPTURE_LINE_SAMPLES 8  // Per UART dump line
+
+_Static_assert(CAPTURE_PRE_TRIGGER + 1 < CAPTURE_SAMPLES, "No room after the trigger");
+_Static_assert(CAPTURE_PRE_TRIGGER <= 255, "Pre-trigger count is one byte");
+_Static_assert(CAPTURE_CHUNKS <= 255, "Chunk index is one byte");
+_Static_assert(CAPTURE_SAMPLE_US <= 0xFFFF, "Sample period field is 16 bits");
+
+typedef enum {
+    CAPTURE_ARMED = 0,
+    CAPTURE_TRIGGERED,
+    CAPTURE_FROZEN
+} Capture_State_t;
+
+static uint16_t buffer[CAPTURE_SAMPLES];
+static volatile Capture_State_t state = CAPTURE_ARMED;
+static uint16_t head = 0;                // Next slot written
+static uint16_t filled = 0;              // Samples since arming, up to the pre-trigger
+static uint16_t remaining = 0;           // Samples still recorded after the trigger
+static volatile uint16_t trip_raw = 0xFFFF;
+static volatile uint8_t trigger_request = CAPTURE_TRIG_NONE;
+
+// Output bitmaps as last reported by the main loop
+static volatile uint16_t outputs_now = 0;
+static volatile uint16_t outputs_prev = 0;
+
+// Frozen capture description
+static uint8_t cause = CAPTURE_TRIG_NONE;
+static uint8_t pre_count = 0;
+static uint32_t trigger_ms = 0;
+static uint16_t trigger_outputs = 0;
+static uint16_t trigger_prev_outputs = 0;
+
+// Download progress
+static bool can_active = false;
+static uint8_t can_chunk = 0;
+static bool uart_pending = false;
+static uint16_t uart_index = 0;
+
+static void capture_arm(void) {
+    cli();
+    head = 0;
+    filled = 0;
+    trigger_request = CAPTURE_TRIG_NONE;
+    state = CAPTURE_ARMED;
+    sei();
+}
+
+// Raw count of the input's limit, follows the calibrated zero
+static uint16_t trip_zero = 0;
+
+static void capture_update_trip(void) {
+    uint16_t zero = Adc_get_zero(CAPTURE_INPUT);
+    uint16_t trip;
+
+    if (zero == trip_zero) {
+        return;
+    }
+    trip_zero = zero;
+    trip = Adc_from_ma(CAPTURE_INPUT, Adc_get_limit_ma(CAPTURE_INPUT)) >> ADC_FRAC_BITS;
+    cli();
+    trip_raw = trip;
+    sei();
+}
+
+void Capture_init(void) {
+    trip_zero = ~Adc_get_zero(CAPTURE_INPUT);  // Force the first computation
+    capture_update_trip();
+    can_active = false;
+    uart_pending = false;
+    capture_arm();
+}
+
+// Sample at oldest + i once frozen
+static uint16_t capture_at(uint16_t i) {
+    uint16_t slot = head + i;
+    return buffer[(slot >= CAPTURE_SAMPLES) ? slot - CAPTURE_SAMPLES : slot];
+}
+
+// ADC ISR, every conversion of CAPTURE_INPUT
+void Capture_sample(uint16_t value) {
+    uint8_t request;
+
+    if (state == CAPTURE_FROZEN) {
+        return;
+    }
+    buffer[head] = value;
+    if (++head >= CAPTURE_SAMPLES) {
+        head = 0;
+    }
+
+    if (state == CAPTURE_TRIGGERED) {
+        if (--remaining == 0) {
+            state = CAPTURE_FROZEN;  // head is now the oldest sample
+        }
+        return;
+    }
+
+    request = (value >= trip_raw) ? CAPTURE_TRIG_OVER_CURRENT : trigger_request;
+    if (request == CAPTURE_TRIG_NONE) {
+        if (filled < CAPTURE_PRE_TRIGGER) {
+            filled++;
+        }
+        return;
+    }
+
+    // This sample is the trigger point
+    cause = request;
+    pre_count = filled;
+    trigger_ms = Timer_now();
+    trigger_outputs = outputs_now;
+    trigger_prev_outputs = outputs_prev;
+    remaining = CAPTURE_SAMPLES - 1 - filled;
+    trigger_request = CAPTURE_TRIG_NONE;
+    state = CAPTURE_TRIGGERED;
+}
+
+// Trigger from the main loop, taken by the next sample
+void Capture_trigger(Capture_Trigger_t why) {
+    if (state == CAPTURE_ARMED && trigger_request == CAPTURE_TRIG_NONE) {
+        trigger_request = why;
+    }
+}
+
+void Capture_note_outputs(uint16_t outputs) {
+    uint8_t sreg = SREG;
+
+    cli();
+    if (outputs != outputs_now) {
+        outputs_prev = outputs_now;
+        outputs_now = outputs;
+        if (CAPTURE_ON_OUTPUT_CHANGE) {
+            Capture_trigger(CAPTURE_TRIG_OUTPUT);
+        }
+    }
+    SREG = sreg;
+}
+
+// Answer to a J1939 request for the capture PGN
+Status_t Capture_request_download(void) {
+    if (state != CAPTURE_FROZEN) {
+        return NOT_READY;
+    }
+    if (!can_active) {
+        can_active = true;
+        can_chunk = 0;
+    }
+    return SUCCESS;
+}
+
+static void capture_fill_chunk(uint8_t chunk, uint8_t *data) {
+    uint16_t first;
+
+    data[0] = chunk;
+    switch (chunk) {
+        case 0:
+            data[1] = cause;
+            data[2] = pre_count;
+            data[3] = (uint8_t)CAPTURE_SAMPLE_US;
+            data[4] = (uint8_t)(CAPTURE_SAMPLE_US >> 8);
+            data[5] = (uint8_t)trigger_outputs;
+            data[6] = (uint8_t)(trigger_outputs >> 8);
+            data[7] = (uint8_t)CAPTURE_INPUT;
+            break;
+        case 1:
+            data[1] = (uint8_t)trigger_ms;
+            data[2] = (uint8_t)(trigger_ms >> 8);
+            data[3] = (uint8_t)(trigger_ms >> 16);
+            data[4] = (uint8_t)(trigger_ms >> 24);
+            data[5] = (uint8_t)trigger_prev_outputs;
+            data[6] = (uint8_t)(trigger_prev_outputs >> 8);
+            data[7] = 0;
+            break;
+        default:
+            // Oldest first, sample pre_count is the trigger point
+            first = (uint16_t)(chunk - CAPTURE_HEADER_CHUNKS) * CAPTURE_SAMPLES_PER_CHUNK;
+            for (uint8_t i = 0; i < CAPTURE_SAMPLES_PER_CHUNK; i++) {
+                uint16_t value = (first + i < CAPTURE_SAMPLES) ? capture_at(first + i) : 0xFFFF;
+                data[1 + 2 * i] = (uint8_t)value;
+                data[2 + 2 * i] = (uint8_t)(value >> 8);
+            }
+            data[7] = 0;
+            break;
+    }
+}
+
+// One CAN chunk per call, retried while the TX MOb is busy
+static void capture_send_chunk(void) {
+    CAN_Message_t msg;
+
+    if (!J1939_is_claimed()) {
+        return;
+    }
+    msg.id = CAN_CAPTURE_ID_BASE | CAN_get_node_addr();
+    msg.length = 8;
+    capture_fill_chunk(can_chunk, msg.data);
+    if (CAN_send(&msg) != SUCCESS) {
+        return;
+    }
+    if (++can_chunk >= CAPTURE_CHUNKS) {
+        can_active = false;
+        uart_pending = false;
+        capture_arm();
+    }
+}
+
+// One line per call so the blocking debug UART never stalls the loop long
+static void capture_print_line(void) {
+    if (uart_index == 0) {
+        DEBUG_PRINT("Capture cause ");
+        DEBUG_PRINT_NUM(cause);
+        DEBUG_PRINT(" at ");
+        DEBUG_PRINT_NUM(trigger_ms);
+        DEBUG_PRINT(" ms, pre ");
+        DEBUG_PRINT_NUM(pre_count);
+        DEBUG_PRINT(", outputs ");
+        DEBUG_PRINT_HEX(trigger_prev_outputs >> 8);
+        DEBUG_PRINT_HEX(trigger_prev_outputs);
+        DEBUG_PRINT(" -> ");
+        DEBUG_PRINT_HEX(trigger_outputs >> 8);
+        DEBUG_PRINT_HEX(trigger_outputs);
+        DEBUG_PRINTLN("");
+    }
+    DEBUG_PRINT_NUM(uart_index);
+    DEBUG_PRINT(":");
+    for (uint8_t i = 0; i < CAPTURE_LINE_SAMPLES && uart_index < CAPTURE_SAMPLES; i++) {
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_NUM(capture_at(uart_index++));
+    }
+    DEBUG_PRINTLN("");
+    if (uart_index >= CAPTURE_SAMPLES) {
+        uart_pending = false;
+    }
+}
+
+// Main loop, every pass
+void Capture_update(void) {
+    static bool was_frozen = false;
+    bool frozen = (state == CAPTURE_FROZEN);
+
+    if (!frozen) {
+        capture_update_trip();
+    } else if (!was_frozen && DEBUG_ENABLED) {
+        uart_pending = true;
+        uart_index = 0;
+    }
+    was_frozen = frozen;
+
+    if (frozen && can_active) {
+        capture_send_chunk();
+    } else if (frozen && uart_pending) {
+        capture_print_line();
+    }
+}
+
+#endif // CAPTURE_ENABLED
@@ -0,0 +1,35 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "common.h"
+#include "config.h"
+
+typedef enum {
+    CAPTURE_TRIG_NONE = 0,
+    CAPTURE_TRIG_OVER_CURRENT,   // Sample above the input's limit, or a logged trip
+    CAPTURE_TRIG_OUTPUT          // Output bitmap changed
+} Capture_Trigger_t;
+
+// Download frames: two header chunks, then three samples per chunk
+#define CAPTURE_SAMPLES_PER_CHUNK 3
+#define CAPTURE_HEADER_CHUNKS 2
+#define CAPTURE_CHUNKS (CAPTURE_HEADER_CHUNKS + \
+    (CAPTURE_SAMPLES + CAPTURE_SAMPLES_PER_CHUNK - 1) / CAPTURE_SAMPLES_PER_CHUNK)
+
+#if CAPTURE_ENABLED
+void Capture_init(void);
+void Capture_sample(uint16_t value);
+void Capture_trigger(Capture_Trigger_t cause);
+void Capture_note_outputs(uint16_t outputs);
+Status_t Capture_request_download(void);
+void Capture_update(void);
+#else
+static inline void Capture_init(void) {}
+static inline void Capture_sample(uint16_t value) { (void)value; }
+static inline void Capture_trigger(Capture_Trigger_t cause) { (void)cause; }
+static inline void Capture_note_outputs(uint16_t outputs) { (void)outputs; }
+static inline Status_t Capture_request_download(void) { return NOT_READY; }
+static inline void Capture_update(void) {}
+#endif
+
+#endif // CAPTURE_H
@@ -0,0 +1,103 @@
+#include "cmd_monitor.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include "soft_timer.h"
+#include "debug.h"
+
+static Soft_Timer_t deadline_timer;
+static uint16_t timeout_ms = CMD_TIMEOUT_MS;
+static volatile bool timeout_pending = false;
+static volatile bool timed_out = false;
+
+// Inter-arrival statistics, updated from the CAN interrupt
+static volatile uint32_t last_arrival = 0;
+static volatile bool first_frame = true;
+static volatile uint16_t interval_min = 0xFFFF;
+static volatile uint16_t interval_max = 0;
+static volatile uint16_t timeout_count = 0;
+static volatile uint16_t jitter_hist[CMD_JITTER_BINS];
+
+static void deadline_expired(void *arg) {
+    (void)arg;
+    timed_out = true;
+    timeout_pending = true;
+    timeout_count++;
+}
+
+void Cmd_monitor_init(void) {
+    uint16_t stored = eeprom_read_word((uint16_t*)EEPROM_CMD_TIMEOUT);
+    if (stored != 0xFFFF && stored != 0) {
+        timeout_ms = stored;
+    }
+
+    for (uint8_t i = 0; i < CMD_JITTER_BINS; i++) {
+        jitter_hist[i] = 0;
+    }
+    Timer_setup(&deadline_timer, deadline_expired, NULL);
+
+    DEBUG_PRINT("Command timeout: ");
+    DEBUG_PRINT_NUM(timeout_ms);
+    DEBUG_PRINTLN(" ms");
+}
+
+// Called from the CAN interrupt for every valid command frame
+void Cmd_frame_received(void) {
+    uint32_t now = Timer_now();
+
+    if (!first_frame) {
+        uint32_t interval = now - last_arrival;
+        uint16_t clamped = (interval > 0xFFFF) ? 0xFFFF : (uint16_t)interval;
+        uint8_t bin = clamped / CMD_JITTER_BIN_MS;
+
+        if (bin >= CMD_JITTER_BINS) bin = CMD_JITTER_BINS - 1;
+        if (jitter_hist[bin] < 0xFFFF) jitter_hist[bin]++;
+        if (clamped < interval_min) interval_min = clamped;
+        if (clamped > interval_max) interval_max = clamped;
+    }
+    first_frame = false;
+    last_arrival = now;
+    timed_out = false;
+
+    Timer_arm(&deadline_timer, timeout_ms, 0);
+}
+
+// True once per expired deadline, the main loop then drops momentary outputs
+bool Cmd_take_timeout(void) {
+    bool pending;
+
+    cli();
+    pending = timeout_pending;
+    timeout_pending = false;
+    sei();
+
+    return pending;
+}
+
+bool Cmd_is_timed_out(void) {
+    return timed_out;
+}
+
+// Entry 0: min/max interval and timeout count, entries 1..: histogram bins
+void Cmd_fill_frame(uint8_t entry, uint8_t *data) {
+    data[0] = entry;
+
+    cli();
+    if (entry == 0) {
+        uint16_t min = (interval_min == 0xFFFF) ? 0 : interval_min;
+        data[1] = (uint8_t)min;
+        data[2] = (uint8_t)(min >> 8);
+        data[3] = (uint8_t)interval_max;
+        data[4] = (uint8_t)(interval_max >> 8);
+        data[5] = (uint8_t)timeout_count;
+        data[6] = (uint8_t)(timeout_count >> 8);
+    } else {
+        uint8_t first = (entry - 1) * CMD_JITTER_BINS_PER_FRAME;
+        for (uint8_t i = 0; i < CMD_JITTER_BINS_PER_FRAME; i++) {
+            uint16_t count = (first + i < CMD_JITTER_BINS) ? jitter_hist[first + i] : 0;
+            data[1 + 2 * i] = (uint8_t)count;
+            data[2 + 2 * i] = (uint8_t)(count >> 8);
+        }
+    }
+    sei();
+}
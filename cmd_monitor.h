@@ -0,0 +1,16 @@
+#ifndef CMD_MONITOR_H
+#define CMD_MONITOR_H
+
+#include "common.h"
+#include "config.h"
+
+#define CMD_JITTER_BINS_PER_FRAME 3
+#define CMD_TELEMETRY_ENTRIES (1 + (CMD_JITTER_BINS + CMD_JITTER_BINS_PER_FRAME - 1) / CMD_JITTER_BINS_PER_FRAME)
+
+void Cmd_monitor_init(void);
+void Cmd_frame_received(void);
+bool Cmd_take_timeout(void);
+bool Cmd_is_timed_out(void);
+void Cmd_fill_frame(uint8_t entry, uint8_t *data);
+
+#endif // CMD_MONITOR_H
@@ -0,0 +1,184 @@
+#include "coil_diag.h"
+#include "adc_scan.h"
+#include "solenoid.h"
+#include "error_handler.h"
+#include "soft_timer.h"
+#include "debug.h"
+#include "led.h"
+
+/*
+ * A coil is judged only when it is switched on alone: the bitmap gains
+ * exactly that bit and has been unchanged for COIL_SETTLE_MS, so every
+ * other coil carries steady current. The filtered current of the sense
+ * input covering the coil is taken just before the pin is written and
+ * again COIL_SETTLE_MS later. The step must lie in the function's range.
+ * A healthy step clears an earlier fault. Proportional functions are
+ * skipped, their current depends on duty and ramp.
+ */
+typedef struct {
+    uint16_t min_ma;
+    uint16_t max_ma;
+} Coil_Range_t;
+
+#define COIL_DEFAULT_RANGE {COIL_MIN_MA, COIL_MAX_MA}
+
+static const Coil_Range_t ranges[FUNCTION_COUNT] = {
+    [FUNCTION_C] = COIL_DEFAULT_RANGE,
+    [FUNCTION_D] = COIL_DEFAULT_RANGE,
+    [FUNCTION_E] = COIL_DEFAULT_RANGE,
+    [FUNCTION_F] = COIL_DEFAULT_RANGE,
+    [FUNCTION_G] = COIL_DEFAULT_RANGE,
+    [FUNCTION_H] = COIL_DEFAULT_RANGE,
+    [FUNCTION_M] = COIL_DEFAULT_RANGE,
+    [FUNCTION_N] = COIL_DEFAULT_RANGE,
+    [FUNCTION_A] = COIL_DEFAULT_RANGE,
+    [FUNCTION_P] = COIL_DEFAULT_RANGE,
+    [FUNCTION_J] = COIL_DEFAULT_RANGE,
+    [FUNCTION_L] = COIL_DEFAULT_RANGE
+};
+
+static uint8_t sense[FUNCTION_COUNT];   // Narrowest input carrying the coil
+static int16_t delta_ma[FUNCTION_COUNT];
+static uint16_t skip_mask = 0;          // Proportional functions
+static uint16_t open_mask = 0;
+static uint16_t short_mask = 0;
+
+static uint16_t last = 0;
+static uint32_t last_change = 0;
+static bool measuring = false;
+static uint8_t function = 0;
+static uint16_t expected = 0;           // Bitmap that must hold during the check
+static int32_t baseline = 0;
+static uint32_t started = 0;
+static uint8_t last_function = FUNCTION_COUNT;
+
+static uint8_t coil_count(uint16_t bits) {
+    uint8_t count = 0;
+    while (bits) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+void Coil_init(void) {
+    for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+        uint8_t best = 0;
+        uint8_t best_width = 0xFF;
+
+        for (uint8_t ch = 0; ch < SENSE_COUNT; ch++) {
+            uint16_t coils = Adc_get_coils((Adc_Channel_t)ch);
+            if ((coils & (1 << f)) && coil_count(coils) < best_width) {
+                best = ch;
+                best_width = coil_count(coils);
+            }
+        }
+        sense[f] = best;
+        delta_ma[f] = 0;
+    }
+    skip_mask = CAN_get_duty_mask();
+    open_mask = 0;
+    short_mask = 0;
+    last = 0;
+    last_change = Timer_now();
+    measuring = false;
+}
+
+// Called with the next bitmap before the pins are written
+void Coil_note_outputs(uint16_t next) {
+    uint16_t added = next & ~last;
+    uint32_t now;
+
+    if (next == last) {
+        return;
+    }
+    now = Timer_now();
+    measuring = false;
+
+    // Exactly one coil added, none released, after a quiet period
+    if (!(last & ~next) && added && !(added & (added - 1)) && !(added & skip_mask) &&
+        now - last_change >= COIL_SETTLE_MS) {
+        for (function = 0; !(added & (1 << function)); function++) {
+        }
+        baseline = Adc_get_ma((Adc_Channel_t)sense[function]);
+        expected = next;
+        started = now;
+        measuring = true;
+    }
+    last = next;
+    last_change = now;
+}
+
+static void coil_report(uint16_t *mask, uint16_t bit, bool fault, Error_t error) {
+    if (!fault) {
+        if (*mask == bit) {
+            // Last coil with this fault is healthy again
+            LED_clear_flash_code(LED_OUTPUT, error);
+        }
+        *mask &= ~bit;
+    } else if (!(*mask & bit)) {
+        *mask |= bit;
+        DEBUG_PRINT("Coil ");
+        DEBUG_PRINT_NUM(function);
+        DEBUG_PRINT(" step ");
+        DEBUG_PRINT_NUM(delta_ma[function]);
+        DEBUG_PRINTLN(" mA");
+        Err_trigger_err_protocol(error);
+    }
+}
+
+// Called with the current check
+void Coil_update(void) {
+    int32_t delta;
+    uint16_t bit;
+
+    if (!measuring) {
+        return;
+    }
+    if (Sol_get_output_bitmap() != expected) {
+        measuring = false;
+        return;
+    }
+    if (Timer_now() - started < COIL_SETTLE_MS) {
+        return;
+    }
+    measuring = false;
+
+    delta = Adc_get_ma((Adc_Channel_t)sense[function]) - baseline;
+    delta_ma[function] = (delta > INT16_MAX) ? INT16_MAX : (delta < INT16_MIN) ? INT16_MIN : (int16_t)delta;
+    last_function = function;
+
+    bit = (uint16_t)(1 << function);
+    coil_report(&open_mask, bit, delta < ranges[function].min_ma, ERROR_COIL_OPEN);
+    coil_report(&short_mask, bit, delta > ranges[function].max_ma, ERROR_COIL_SHORT);
+}
+
+uint16_t Coil_get_open_mask(void) {
+    return open_mask;
+}
+
+uint16_t Coil_get_short_mask(void) {
+    return short_mask;
+}
+
+// Every frame starts with its entry index
+// Entry 0: open and short bitmaps, last function judged, its step is in
+// the entry that holds that function
+// Entry 1..: steps in mA from function (entry - 1) * COIL_DELTAS_PER_FRAME on
+void Coil_fill_frame(uint8_t entry, uint8_t *data) {
+    data[0] = entry;
+    if (entry == 0) {
+        data[1] = (uint8_t)open_mask;
+        data[2] = (uint8_t)(open_mask >> 8);
+        data[3] = (uint8_t)short_mask;
+        data[4] = (uint8_t)(short_mask >> 8);
+        data[5] = last_function;
+        return;
+    }
+
+    uint8_t first = (entry - 1) * COIL_DELTAS_PER_FRAME;
+    for (uint8_t i = 0; i < COIL_DELTAS_PER_FRAME && first + i < FUNCTION_COUNT; i++) {
+        data[1 + 2 * i] = (uint8_t)delta_ma[first + i];
+        data[2 + 2 * i] = (uint8_t)((uint16_t)delta_ma[first + i] >> 8);
+    }
+}
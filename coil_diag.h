@@ -0,0 +1,19 @@
+#ifndef COIL_DIAG_H
+#define COIL_DIAG_H
+
+#include "common.h"
+#include "config.h"
+#include "can_lookup.h"
+
+// Entry 0 summary, then three per-function current steps per frame
+#define COIL_DELTAS_PER_FRAME 3
+#define COIL_TELEMETRY_ENTRIES (1 + (FUNCTION_COUNT + COIL_DELTAS_PER_FRAME - 1) / COIL_DELTAS_PER_FRAME)
+
+void Coil_init(void);
+void Coil_note_outputs(uint16_t next);
+void Coil_update(void);
+uint16_t Coil_get_open_mask(void);
+uint16_t Coil_get_short_mask(void);
+void Coil_fill_frame(uint8_t entry, uint8_t *data);
+
+#endif // COIL_DIAG_H
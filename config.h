@@ -4,15 +4,64 @@
 // System Configuration
 #define F_CPU 16000000UL
 #define CAN_BAUD_RATE 250000
+#define CAN_SAMPLE_POINT 750  // Per mille of the bit time
+#define CAN_SJW 1             // Resynchronisation jump width in Tq
 #define CAN_MSG_ID 0x14FFFFB0
+#define CAN_STATUS_ID_BASE 0x18FF5000 // Node address in the low byte
+#define CAN_DEFAULT_NODE_ADDR 0x80
+#define CAN_DIAG_ID_BASE 0x18FF5100 // Telemetry frames, node address in the low byte
+#define CAN_CAPTURE_ID_BASE 0x18FF5200 // Waveform download, node address in the low byte
+#define TELEMETRY_PERIOD_MS 100
+
+// Listen-only bit-rate detection at start-up, bounded to
+// CAN_AUTOBAUD_PASSES x 4 rates x CAN_AUTOBAUD_WINDOW_MS
+#ifndef CAN_AUTOBAUD_ENABLED
+#define CAN_AUTOBAUD_ENABLED 1
+#endif
+#define CAN_AUTOBAUD_WINDOW_MS 200
+#define CAN_AUTOBAUD_PASSES 3
+#define CAN_AUTOBAUD_LOCK_FRAMES 3   // Error-free frames needed to lock
+
+// J1939 NAME for address claim, the low identity byte is the node address
+#define J1939_ARBITRARY_ADDRESS_CAPABLE 1
+#define J1939_INDUSTRY_GROUP 3        // Construction equipment
+#define J1939_FUNCTION 129            // Vehicle-specific valve controller
+#define J1939_MANUFACTURER_CODE 0     // Replace with the assigned SAE code
+#define J1939_IDENTITY_NUMBER 0x1000
 #define MAX_CONCURRENT_CHANNELS 2
 #define MAX_TOTAL_CURRENT 14500 // 14.5A in mA
+#define SOL_DEAD_TIME_MS 50     // Off-to-on gap when a pair reverses direction
+
+// Proportional outputs (can_lookup_table entries with a duty byte), Timer2
+// software PWM. The tick rate PWM_FREQ_HZ * PWM_STEPS must fit Timer2 /64
+#define PWM_FREQ_HZ 100
+#define PWM_STEPS 64             // Duty resolution per period
+#define PWM_RAMP_MS 250          // Slowest 0-100% change, a zero duty cuts at once
+
+// Command deadline monitor
+#define CMD_TIMEOUT_MS 500       // Momentary outputs drop after this silence
+#define CMD_JITTER_BINS 8        // Inter-arrival histogram, last bin is open ended
+#define CMD_JITTER_BIN_MS 25
+
+// CAN bus-off recovery, backoff doubles per bus-off until stable again
+#define CAN_BUSOFF_BACKOFF_MIN_MS 10
+#define CAN_BUSOFF_BACKOFF_MAX_MS 1000
+#define CAN_BUSOFF_STABLE_MS 5000
 
 // EEPROM Addresses
 #define EEPROM_CAN_BAUD 0x00
 #define EEPROM_CAN_ID 0x04
 #define EEPROM_MODE_PAIR1 0x08
 #define EEPROM_MODE_PAIR6 0x09
+#define EEPROM_NODE_ADDR 0x10
+#define EEPROM_CMD_TIMEOUT 0x12 // 16-bit, ms
+#define EEPROM_RESET_CAUSE 0x14 // MCUSR of the last start
+#define EEPROM_WDT_MISSED 0x15  // Sup_Task_t bits missed before the last watchdog reset
+#define EEPROM_WDT_RESETS 0x16  // 16-bit count
+#define EEPROM_BOOT_COUNT 0x18  // 16-bit
+#define EEPROM_DEAD_TIME 0x20   // One byte per pair in ms, 0 disables
+#define EEPROM_ADC_ZERO 0x28    // 16-bit Q6 zero per sense input, see current_cal.c
+#define EEPROM_EVENT_LOG 0x100  // EVENT_LOG_SLOTS records, see event_log.c
 
 // Safety Parameters
 // Current Sensor Configuration
@@ -21,10 +70,82 @@
 #define ADC_RESOLUTION 1024          // 10-bit ADC
 #define CURRENT_SENSOR_ZERO_POINT 512 // 2.5V for ACS712
 #define CURRENT_SENSOR_SENSITIVITY 0.066 // 66mV/A for ACS712 30A
+
+// ADC scan sequencer (adc_scan.c), inputs in BOARD_ADC_LIST
+#define BOARD_BANK_SENSE 0           // 1: variant with per-bank shunts on ADC2/ADC3
+#define MAX_BANK_CURRENT 10000       // Per-bank limit in mA on that variant
+#define ADC_SCAN_RATE_HZ 4000        // Conversions per second, shared by all inputs
+#define ADC_FILTER_SHIFT 3           // Low-pass over 2^n samples of each input
+
+// Sense zero calibration, only while every coil pin is low
+#define CAL_SETTLE_MS 200            // Coil current decay before sampling
+#define CAL_SAMPLES 16               // Readings per estimate, one per current check
+#define CAL_MAX_OFFSET 40            // Counts from nominal, beyond is a sensor fault
+#define CAL_DRIFT_SHIFT 2            // Later estimates move the zero by 1/2^n
+#define CAL_EEPROM_DELTA 64          // Q6 change (1 count) before it is stored again
+
+// Coil diagnosis from the current step of single activations (coil_diag.c),
+// per-function ranges in coil_diag.c default to these
+#define COIL_SETTLE_MS 200           // Current rise time, also quiet time required before
+#define COIL_MIN_MA 300              // Below: open load
+#define COIL_MAX_MA 4000             // Above: shorted coil
+
+// Current waveform capture around trips (capture.c), 2 bytes SRAM per sample
+#define CAPTURE_ENABLED 1
+#define CAPTURE_INPUT SENSE_TOTAL        // BOARD_ADC_LIST input recorded
+#define CAPTURE_SAMPLES 256
+#define CAPTURE_PRE_TRIGGER 64           // Samples kept from before the trigger
+#define CAPTURE_ON_OUTPUT_CHANGE 0       // 1: every output change freezes (inrush)
 //#define CURRENT_SENSOR_ACS712_RATIO 66 // 30A sensor = 66mV/A
 
 // Debug configuration
+#ifndef DEBUG_ENABLED
 #define DEBUG_ENABLED 1  // Set to 0 to disable debug prints
+#endif
 #define DEBUG_UART_BAUD 9600
 
+// Profiling configuration
+#define PROFILING_ENABLED 1  // Set to 0 to compile out PROFILE_BEGIN/END
+#define PROFILE_DUMP_PERIOD_MS 10000  // Statistics window, reset after each dump
+
+// Watchdog supervisor: the watchdog is fed only while every activity has
+// checked in within its window, worst-case recovery is window + timeout
+#define WDT_TIMEOUT WDTO_500MS
+#define SUP_CHECK_PERIOD_MS 50
+#define SUP_CAN_WINDOW_MS 1000      // Generous for blocking debug output
+#define SUP_CURRENT_WINDOW_MS 1000
+
+// Fault event log
+#define EVENT_RING_SIZE 16          // Newest events kept in SRAM
+#define EVENT_LOG_SLOTS 48          // EEPROM records, wear is spread over all
+#define EVENT_PERSIST_PERIOD_MS 1000  // One record written per period
+
+// Fault injection, host simulation only: host/Makefile sets it and runs
+// the steps in host/fault_script.h
+#ifndef FAULT_INJECTION_ENABLED
+#define FAULT_INJECTION_ENABLED 0
+#endif
+
+// Binary ADC stream on the debug UART (stream.c), COBS framed, read with
+// tools/adc_stream.py. Takes the UART over from debug output
+#define STREAM_ENABLED 0
+#define STREAM_UART_BAUD 250000UL
+#define STREAM_SWEEPS 16             // Sweeps of all sense inputs per packet
+
+// Start-up microbenchmark, JSON on the debug UART (benchmark.c)
+#ifndef BENCHMARK_ENABLED
+#define BENCHMARK_ENABLED 0
+#endif
+#ifndef BENCH_FRAMES
+#define BENCH_FRAMES 64
+#endif
+
+// Idle sleep and CPU load measurement
+#define IDLE_SLEEP_ENABLED 1
+#define CPU_LOAD_WINDOW_MS 1000
+
+// SRAM monitoring
+#define STACK_CANARY 0xC5
+#define MEM_SCAN_PERIOD_MS 1000
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "cpu_load.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "profiler.h"
+#include "soft_timer.h"
+
+// Timer3 ticks per millisecond, see PROFILE_TICK_NS
+#define LOAD_TICKS_PER_MS (F_CPU / 8 / 1000)
+
+static uint32_t idle_ticks = 0;
+static uint32_t window_start = 0;
+static uint8_t load_percent = 0;
+static uint8_t load_peak = 0;
+
+#if IDLE_SLEEP_ENABLED
+volatile bool load_sleeping = false;
+volatile uint16_t load_wake_at = 0;
+#endif
+
+void Load_init(void) {
+    // Idle mode keeps timers, CAN and UART running
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    window_start = Timer_now();
+}
+
+// Call with interrupts disabled after checking there is no work left,
+// returns with interrupts enabled once an interrupt has woken the CPU.
+// Only the time asleep is idle: the waking ISR stamps the wake-up through
+// Load_isr_enter(), so all interrupt work counts as load.
+void Load_sleep(void) {
+#if IDLE_SLEEP_ENABLED
+    uint16_t start = TCNT3;
+
+    load_sleeping = true;
+    sleep_enable();
+    sei();  // The instruction after SEI runs first, no wake-up is lost
+    sleep_cpu();
+    sleep_disable();
+
+    cli();
+    if (load_sleeping) {
+        // Woken by a vector without the hook, count up to here
+        load_wake_at = TCNT3;
+        load_sleeping = false;
+    }
+    // One sleep never outlasts the 1 ms tick, 16 bits cannot wrap
+    idle_ticks += (uint16_t)(load_wake_at - start);
+    sei();
+#else
+    sei();
+#endif
+}
+
+// Close the measurement window, called once per CPU_LOAD_WINDOW_MS
+void Load_update(void) {
+    uint32_t now = Timer_now();
+    uint32_t total_ticks = (now - window_start) * LOAD_TICKS_PER_MS;
+
+    if (total_ticks == 0) {
+        return;
+    }
+    if (idle_ticks > total_ticks) {
+        idle_ticks = total_ticks;
+    }
+
+    load_percent = (uint8_t)((total_ticks - idle_ticks) * 100 / total_ticks);
+    if (load_percent > load_peak) {
+        load_peak = load_percent;
+    }
+
+    idle_ticks = 0;
+    window_start = now;
+}
+
+uint8_t Load_get_percent(void) {
+    return load_percent;
+}
+
+void Load_fill_frame(uint8_t *data) {
+    data[0] = load_percent;
+    data[1] = load_peak;
+}
@@ -0,0 +1,30 @@
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include "common.h"
+#include "config.h"
+#include <avr/io.h>
+
+#if IDLE_SLEEP_ENABLED
+extern volatile bool load_sleeping;
+extern volatile uint16_t load_wake_at;
+
+// First statement of every ISR: the idle period ends when the CPU wakes,
+// the waking ISR itself counts as busy
+static inline void Load_isr_enter(void) {
+    if (load_sleeping) {
+        load_wake_at = TCNT3;
+        load_sleeping = false;
+    }
+}
+#else
+static inline void Load_isr_enter(void) {}
+#endif
+
+void Load_init(void);
+void Load_sleep(void);
+void Load_update(void);
+uint8_t Load_get_percent(void);
+void Load_fill_frame(uint8_t *data);
+
+#endif // CPU_LOAD_H
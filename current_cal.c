@@ -0,0 +1,110 @@
+#include "current_cal.h"
+#include <avr/eeprom.h>
+#include "adc_scan.h"
+#include "solenoid.h"
+#include "soft_timer.h"
+#include "debug.h"
+
+/*
+ * Zero point of every sense input, measured while no coil can carry
+ * current: the output bitmap is empty, every coil pin reads back low and
+ * has done so for CAL_SETTLE_MS. CAL_SAMPLES filtered readings are
+ * averaged per estimate. The first estimate after boot is taken as is,
+ * later ones follow temperature drift through a 1/2^CAL_DRIFT_SHIFT step.
+ */
+#define CAL_EEPROM_ADDR(ch) ((uint16_t *)(EEPROM_ADC_ZERO + 2 * (ch)))
+#define CAL_MAX_OFFSET_Q6 ((uint16_t)CAL_MAX_OFFSET << ADC_FRAC_BITS)
+
+_Static_assert(EEPROM_ADC_ZERO + 2 * SENSE_COUNT <= EEPROM_EVENT_LOG, "Sense zeros overlap the event log");
+
+static uint32_t quiet_since = 0;
+static bool quiet = false;
+static uint8_t samples = 0;
+static uint32_t sum[SENSE_COUNT];
+static uint16_t stored[SENSE_COUNT];  // Last value written to EEPROM
+static bool done = false;
+
+static bool cal_plausible(Adc_Channel_t ch, uint16_t zero) {
+    uint16_t nominal = Adc_get_nominal_zero(ch);
+    uint16_t delta = (zero > nominal) ? zero - nominal : nominal - zero;
+    return delta <= CAL_MAX_OFFSET_Q6;
+}
+
+static void cal_restart(void) {
+    samples = 0;
+    for (uint8_t ch = 0; ch < SENSE_COUNT; ch++) {
+        sum[ch] = 0;
+    }
+}
+
+// Restore the stored zeros, erased or implausible cells keep the board value
+void Cal_init(void) {
+    for (uint8_t ch = 0; ch < SENSE_COUNT; ch++) {
+        uint16_t zero = eeprom_read_word(CAL_EEPROM_ADDR(ch));
+        stored[ch] = zero;
+        if (zero != 0xFFFF && cal_plausible((Adc_Channel_t)ch, zero)) {
+            Adc_set_zero((Adc_Channel_t)ch, zero);
+        }
+    }
+    quiet = false;
+    done = false;
+    cal_restart();
+}
+
+static void cal_apply(void) {
+    for (uint8_t ch = 0; ch < SENSE_COUNT; ch++) {
+        uint16_t estimate = sum[ch] / CAL_SAMPLES;
+        uint16_t zero = Adc_get_zero((Adc_Channel_t)ch);
+
+        if (!cal_plausible((Adc_Channel_t)ch, estimate)) {
+            DEBUG_PRINT("Sense zero out of range: ");
+            DEBUG_PRINT_NUM(ch);
+            DEBUG_PRINTLN("");
+            continue;
+        }
+        if (!done) {
+            zero = estimate;
+        } else {
+            zero = (int32_t)zero + (((int32_t)estimate - zero) >> CAL_DRIFT_SHIFT);
+        }
+        Adc_set_zero((Adc_Channel_t)ch, zero);
+
+        uint16_t moved = (zero > stored[ch]) ? zero - stored[ch] : stored[ch] - zero;
+        if (stored[ch] == 0xFFFF || moved >= CAL_EEPROM_DELTA) {
+            eeprom_update_word(CAL_EEPROM_ADDR(ch), zero);
+            stored[ch] = zero;
+        }
+    }
+    done = true;
+}
+
+// Called with the current check, restarts whenever a coil may conduct
+void Cal_update(void) {
+    uint32_t now = Timer_now();
+
+    if (Sol_get_output_bitmap() != 0 || !Sol_pins_off()) {
+        quiet = false;
+        cal_restart();
+        return;
+    }
+    if (!quiet) {
+        quiet = true;
+        quiet_since = now;
+        return;
+    }
+    if (now - quiet_since < CAL_SETTLE_MS) {
+        return;
+    }
+
+    for (uint8_t ch = 0; ch < SENSE_COUNT; ch++) {
+        sum[ch] += Adc_get_filtered((Adc_Channel_t)ch);
+    }
+    if (++samples >= CAL_SAMPLES) {
+        cal_apply();
+        cal_restart();
+    }
+}
+
+bool Cal_is_done(void) {
+    return done;
+}
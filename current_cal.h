@@ -0,0 +1,11 @@
+#ifndef CURRENT_CAL_H
+#define CURRENT_CAL_H
+
+#include "common.h"
+#include "config.h"
+
+void Cal_init(void);
+void Cal_update(void);
+bool Cal_is_done(void);
+
+#endif // CURRENT_CAL_H
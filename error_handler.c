@@ -4,81 +4,34 @@
 #include <util/delay.h>
 #include "led.h"
 #include "debug.h"
-#define CURRENT_SAMPLES 16  // Number of samples for averaging
+#include "solenoid.h"
+#include "event_log.h"
+#include "fault_inject.h"
+#include "adc_scan.h"
+#include "capture.h"
 
 static Error_t current_error = ERROR_NONE;
 static bool output_active = false;  // Flag to indicate if any output is active
 
-// Initialize ADC for current sensing on PF1 (ADC1)
-static void ADC_init(void) {
-    // Set PF1 as input (ADC1)
-    DDRF &= ~(1 << PF1);
-    
-    // AVCC with external capacitor at AREF pin
-    ADMUX = (1 << REFS0);
-    
-    // Enable ADC and set prescaler to 128 (16MHz/128 = 125kHz)
-    ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
-    
-    DEBUG_PRINTLN("ADC initialized for current sensing on PF1 (ADC1)");
-}
-
-// Read ADC value from current sensor on PF1 (ADC1)
-static uint16_t ADC_read(void) {
-    // Select ADC1 channel (PF1)
-    ADMUX = (ADMUX & 0xF0) | (CURRENT_SENSOR_ADC_CHANNEL & 0x0F);
-    
-    // Start single conversion
-    ADCSRA |= (1 << ADSC);
-    
-    // Wait for conversion to complete
-    while (ADCSRA & (1 << ADSC));
-    
-    // Return ADC value
-    return ADC;
-}
-
-// Read current in Amps
+// Latest single conversion of the supply sensor, in Amps
 float Err_read_current(void) {
-    uint16_t adc_value = ADC_read();
-    
-    // Convert ADC value to voltage
-    float voltage = (adc_value * ADC_REF_VOLTAGE) / ADC_RESOLUTION;
-    
-    // Convert voltage to current (A)
-    float current = (voltage - (ADC_REF_VOLTAGE/2)) / CURRENT_SENSOR_SENSITIVITY;
+    uint16_t adc_value = Adc_get_raw(SENSE_TOTAL);
+    float current = Adc_to_ma(SENSE_TOTAL, adc_value << ADC_FRAC_BITS) / 1000.0;
     
     DEBUG_PRINT("Current Sensor (PF1) - Raw: ");
     DEBUG_PRINT_NUM(adc_value);
-    DEBUG_PRINT(" (");
-    DEBUG_PRINT_NUM((int)(voltage * 1000)); // mV
-    DEBUG_PRINT("mV) Current: ");
+    DEBUG_PRINT(" Current: ");
     DEBUG_PRINT_NUM((int)(current * 1000)); // mA
     DEBUG_PRINTLN(" mA");
     
     return current;
 }
 
+// Low-pass filtered by the scan ISR, no conversion is waited for
 float Err_read_current_filtered(void) {
-    uint32_t adc_sum = 0;
-    
-    // Take multiple samples for averaging
-    for (uint8_t i = 0; i < CURRENT_SAMPLES; i++) {
-        adc_sum += ADC_read();
-        _delay_us(100);  // Small delay between samples
-    }
-    
-    uint16_t adc_avg = adc_sum / CURRENT_SAMPLES;
-    
-    // Convert to current
-    float voltage = (adc_avg * ADC_REF_VOLTAGE) / ADC_RESOLUTION;
-    float current = (voltage - (ADC_REF_VOLTAGE/2)) / CURRENT_SENSOR_SENSITIVITY;
+    float current = Adc_get_ma(SENSE_TOTAL) / 1000.0;
     
-    DEBUG_PRINT("Filtered Current (PF1) - Avg Raw: ");
-    DEBUG_PRINT_NUM(adc_avg);
-    DEBUG_PRINT(" (");
-    DEBUG_PRINT_NUM((int)(voltage * 1000));
-    DEBUG_PRINT("mV) Current: ");
+    DEBUG_PRINT("Filtered Current (PF1): ");
     DEBUG_PRINT_NUM((int)(current * 1000));
     DEBUG_PRINTLN(" mA");
     
@@ -88,17 +41,25 @@ float Err_read_current_filtered(void) {
 void Err_init(void) {
     current_error = ERROR_NONE;
     output_active = false;
-    ADC_init();  // Initialize ADC for current sensing
+    Adc_init();  // Start the current sense scan
     DEBUG_PRINTLN("Error handler initialized");
 }
 
 void Err_detect_sys_error(void) {
-    // Only check current if outputs are active
+    // Only check current if outputs are active, the supply and every bank
+    // have their own limit
     if (output_active) {
-        float current = Err_read_current_filtered();
-        
-        if (current > (MAX_TOTAL_CURRENT / 1000.0)) {
-            Err_trigger_err_protocol(ERROR_OVER_CURRENT);
+        for (uint8_t ch = 0; ch < SENSE_COUNT; ch++) {
+            int32_t ma = Adc_get_ma((Adc_Channel_t)ch);
+            if (ma > Adc_get_limit_ma((Adc_Channel_t)ch)) {
+                DEBUG_PRINT("Sense input ");
+                DEBUG_PRINT_NUM(ch);
+                DEBUG_PRINT(": ");
+                DEBUG_PRINT_NUM((int)ma);
+                DEBUG_PRINTLN(" mA");
+                Err_trigger_err_protocol(ERROR_OVER_CURRENT);
+                break;
+            }
         }
     }
     
@@ -109,6 +70,10 @@ void Err_log_error(Error_t error, const char* module) {
     if (error >= ERROR_COUNT) return;
     
     current_error = error;
+    Fault_note_error(error);
+    
+    float amps = Err_read_current();
+    Event_record(error, (amps > 0) ? (uint16_t)(amps * 1000) : 0, Sol_get_output_bitmap());
     
     DEBUG_PRINT("Error in ");
     DEBUG_PRINT(module);
@@ -117,22 +82,32 @@ void Err_log_error(Error_t error, const char* module) {
     switch (error) {
         case ERROR_CAN_COMM:
             DEBUG_PRINTLN("CAN communication error");
-            LED_set(LED_CAN, LED_BLINK, 200);
+            LED_set_flash_code(LED_CAN, error);
             break;
         case ERROR_OVER_CURRENT: {
+            Capture_trigger(CAPTURE_TRIG_OVER_CURRENT);  // Bank trips the sample check missed
             float current = Err_read_current();
             DEBUG_PRINT("OVER CURRENT: ");
             DEBUG_PRINT_NUM((int)(current * 1000));
             DEBUG_PRINTLN(" mA");
-            LED_set(LED_POWER, LED_BLINK, 200);
+            LED_set_flash_code(LED_POWER, error);
             break;
         }
         case ERROR_CHANNEL_CONFLICT:
             DEBUG_PRINTLN("Channel conflict detected");
-            LED_set(LED_OUTPUT, LED_BLINK, 200);
+            LED_set_flash_code(LED_OUTPUT, error);
             break;
         case ERROR_EEPROM:
             DEBUG_PRINTLN("EEPROM error");
+            LED_set_flash_code(LED_POWER, error);
+            break;
+        case ERROR_COIL_OPEN:
+            DEBUG_PRINTLN("Coil open load");
+            LED_set_flash_code(LED_OUTPUT, error);
+            break;
+        case ERROR_COIL_SHORT:
+            DEBUG_PRINTLN("Coil short");
+            LED_set_flash_code(LED_OUTPUT, error);
             break;
         default:
             DEBUG_PRINTLN("Unknown error");
@@ -171,4 +146,8 @@ void Err_set_output_active(bool active) {
     } else {
         DEBUG_PRINTLN("All outputs inactive, disabling current monitoring");
     }
+}
+
+Error_t Err_get_current_error(void) {
+    return current_error;
 }
\ No newline at end of file
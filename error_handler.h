@@ -10,6 +10,8 @@ typedef enum {
     ERROR_OVER_CURRENT,
     ERROR_CHANNEL_CONFLICT,
     ERROR_EEPROM,
+    ERROR_COIL_OPEN,
+    ERROR_COIL_SHORT,
     ERROR_COUNT
 } Error_t;
 
@@ -21,5 +23,6 @@ void Err_trigger_err_protocol(Error_t error);
 float Err_read_current(void);  
 float Err_read_current_filtered(void);
 void Err_set_output_active(bool active);  // New function to indicate if outputs are active
+Error_t Err_get_current_error(void);
 
 #endif // ERROR_HANDLER_H
\ No newline at end of file
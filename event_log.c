@@ -0,0 +1,237 @@
+#include "event_log.h"
+#include <avr/eeprom.h>
+#include <stddef.h>
+#include "soft_timer.h"
+#include "debug.h"
+#include "can_lookup.h"
+
+#define EVENT_CODES (ERROR_COUNT - 1)  // ERROR_NONE is never logged
+
+_Static_assert(ERROR_COUNT <= 16 && FUNCTION_COUNT <= 12, "Event frame packs code and outputs in 16 bits");
+_Static_assert(EVENT_LOG_SLOTS >= EVENT_RING_SIZE, "EEPROM log shorter than the SRAM ring");
+
+// One EEPROM slot. Records are appended round-robin over all slots so each
+// cell sees 1/EVENT_LOG_SLOTS of the writes; every record carries the
+// per-code counters so the newest valid slot restores them.
+typedef struct {
+    uint16_t seq;
+    uint16_t boot;
+    uint32_t time_ms;
+    uint16_t current_ma;
+    uint16_t outputs;
+    uint16_t counts[EVENT_CODES];
+    uint8_t code;
+    uint8_t check;
+} Event_Record_t;
+
+_Static_assert(EEPROM_EVENT_LOG + EVENT_LOG_SLOTS * sizeof(Event_Record_t) <= 4096,
+               "Event log exceeds the EEPROM");
+
+static Event_t ring[EVENT_RING_SIZE];
+static uint8_t ring_head = 0;      // Next write
+static uint8_t ring_count = 0;
+static uint8_t ring_unsaved = 0;   // Newest entries not yet in EEPROM
+
+static uint16_t counts[EVENT_CODES];
+static uint16_t boot_count = 0;
+static uint16_t next_seq = 0;
+static uint8_t next_slot = 0;
+
+// Record being written, one byte per Event_service() call
+static Event_Record_t writing;
+static uint8_t write_pos = 0;
+static bool write_active = false;
+
+static Event_Record_t *slot_addr(uint8_t slot) {
+    return (Event_Record_t *)(EEPROM_EVENT_LOG + slot * sizeof(Event_Record_t));
+}
+
+static uint8_t record_check(const Event_Record_t *rec) {
+    const uint8_t *bytes = (const uint8_t *)rec;
+    uint8_t check = 0xA5;  // An erased slot never checks out
+
+    for (uint8_t i = 0; i < offsetof(Event_Record_t, check); i++) {
+        check ^= bytes[i];
+    }
+    return check;
+}
+
+static bool read_slot(uint8_t slot, Event_Record_t *rec) {
+    eeprom_read_block(rec, slot_addr(slot), sizeof(Event_Record_t));
+    return rec->check == record_check(rec) && rec->code > ERROR_NONE && rec->code < ERROR_COUNT;
+}
+
+static void ring_push(const Event_t *event) {
+    ring[ring_head] = *event;
+    ring_head = (ring_head + 1) % EVENT_RING_SIZE;
+    if (ring_count < EVENT_RING_SIZE) {
+        ring_count++;
+    }
+}
+
+void Event_init(void) {
+    Event_Record_t rec;
+    bool found = false;
+    uint8_t newest = 0;
+
+    boot_count = eeprom_read_word((uint16_t*)EEPROM_BOOT_COUNT);
+    boot_count = (boot_count == 0xFFFF) ? 0 : boot_count + 1;
+    eeprom_update_word((uint16_t*)EEPROM_BOOT_COUNT, boot_count);
+
+    // Newest valid record restores the counters and the write position
+    for (uint8_t slot = 0; slot < EVENT_LOG_SLOTS; slot++) {
+        if (read_slot(slot, &rec) && (!found || (int16_t)(rec.seq - next_seq) >= 0)) {
+            found = true;
+            newest = slot;
+            next_seq = rec.seq;
+        }
+    }
+    if (!found) {
+        return;
+    }
+    read_slot(newest, &rec);
+    for (uint8_t i = 0; i < EVENT_CODES; i++) {
+        counts[i] = rec.counts[i];
+    }
+    next_seq = rec.seq + 1;
+    next_slot = (newest + 1) % EVENT_LOG_SLOTS;
+
+    // Reload the newest records so the history is readable over CAN at once
+    for (uint8_t n = EVENT_RING_SIZE; n > 0; n--) {
+        uint8_t slot = (newest + EVENT_LOG_SLOTS - (n - 1)) % EVENT_LOG_SLOTS;
+        if (read_slot(slot, &rec) && (uint16_t)(next_seq - rec.seq) <= EVENT_RING_SIZE) {
+            Event_t event = { rec.time_ms, rec.boot, rec.current_ma, rec.outputs, rec.code };
+            ring_push(&event);
+        }
+    }
+}
+
+// Main loop only, the EEPROM write happens later in Event_persist()
+void Event_record(Error_t code, uint16_t current_ma, uint16_t outputs) {
+    Event_t event;
+
+    if (code == ERROR_NONE || code >= ERROR_COUNT) {
+        return;
+    }
+    if (counts[code - 1] != 0xFFFF) {
+        counts[code - 1]++;
+    }
+
+    event.time_ms = Timer_now();
+    event.boot = boot_count;
+    event.current_ma = current_ma;
+    event.outputs = outputs;
+    event.code = code;
+    ring_push(&event);
+    if (ring_unsaved < EVENT_RING_SIZE) {
+        ring_unsaved++;
+    }
+}
+
+// Start writing the oldest unsaved event, at most one record per call.
+// The bytes go out from Event_service() so the loop never waits on EEPROM.
+void Event_persist(void) {
+    const Event_t *event;
+
+    if (ring_unsaved == 0 || write_active) {
+        return;
+    }
+    event = &ring[(ring_head + EVENT_RING_SIZE - ring_unsaved) % EVENT_RING_SIZE];
+
+    writing.seq = next_seq;
+    writing.boot = event->boot;
+    writing.time_ms = event->time_ms;
+    writing.current_ma = event->current_ma;
+    writing.outputs = event->outputs;
+    for (uint8_t i = 0; i < EVENT_CODES; i++) {
+        writing.counts[i] = counts[i];
+    }
+    writing.code = event->code;
+    writing.check = record_check(&writing);
+    write_pos = 0;
+    write_active = true;
+}
+
+// Main loop, every pass: start the next byte once the previous one is
+// done. The check byte goes last, a record cut short by a reset is invalid.
+void Event_service(void) {
+    uint8_t *addr;
+
+    if (!write_active || !eeprom_is_ready()) {
+        return;
+    }
+    addr = (uint8_t *)slot_addr(next_slot) + write_pos;
+    eeprom_update_byte(addr, ((const uint8_t *)&writing)[write_pos]);
+    if (++write_pos < sizeof(Event_Record_t)) {
+        return;
+    }
+
+    write_active = false;
+    next_seq++;
+    next_slot = (next_slot + 1) % EVENT_LOG_SLOTS;
+    if (ring_unsaved > 0) {
+        ring_unsaved--;
+    }
+}
+
+uint16_t Event_get_count(Error_t code) {
+    if (code == ERROR_NONE || code >= ERROR_COUNT) {
+        return 0;
+    }
+    return counts[code - 1];
+}
+
+// Entry 0: counts for CAN, over-current, channel conflict
+// Entry 1: EEPROM error count, boot count, events held in the ring
+// Entry 2..: seconds since boot, current mA, outputs with the code in the
+// top nibble (oldest first)
+void Event_fill_frame(uint8_t entry, uint8_t *data) {
+    data[0] = entry;
+
+    if (entry == 0) {
+        for (uint8_t i = 0; i < 3; i++) {
+            data[1 + 2 * i] = (uint8_t)counts[i];
+            data[2 + 2 * i] = (uint8_t)(counts[i] >> 8);
+        }
+    } else if (entry == 1) {
+        data[1] = (uint8_t)counts[ERROR_EEPROM - 1];
+        data[2] = (uint8_t)(counts[ERROR_EEPROM - 1] >> 8);
+        data[3] = (uint8_t)boot_count;
+        data[4] = (uint8_t)(boot_count >> 8);
+        data[5] = ring_count;
+    } else if ((uint8_t)(entry - 2) < ring_count) {
+        const Event_t *event = &ring[(ring_head + EVENT_RING_SIZE - ring_count + entry - 2) % EVENT_RING_SIZE];
+        uint16_t seconds = (uint16_t)(event->time_ms / 1000);
+
+        data[1] = (uint8_t)seconds;
+        data[2] = (uint8_t)(seconds >> 8);
+        data[3] = (uint8_t)event->current_ma;
+        data[4] = (uint8_t)(event->current_ma >> 8);
+        data[5] = (uint8_t)event->outputs;
+        data[6] = (uint8_t)((event->code << 4) | ((event->outputs >> 8) & 0x0F));
+    }
+}
+
+// Print the whole EEPROM history over the debug UART
+void Event_dump(void) {
+    Event_Record_t rec;
+
+    DEBUG_PRINTLN("Event log (seq boot ms code mA outputs):");
+    for (uint8_t slot = 0; slot < EVENT_LOG_SLOTS; slot++) {
+        if (!read_slot(slot, &rec)) continue;
+
+        DEBUG_PRINT_NUM(rec.seq);
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_NUM(rec.boot);
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_NUM(rec.time_ms);
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_NUM(rec.code);
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_NUM(rec.current_ma);
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_HEX((uint8_t)(rec.outputs >> 8));
+        DEBUG_PRINT_HEX((uint8_t)rec.outputs);
+        DEBUG_PRINTLN("");
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "common.h"
+#include "config.h"
+#include "error_handler.h"
+
+typedef struct {
+    uint32_t time_ms;     // Since start of boot
+    uint16_t boot;        // Power-cycle count
+    uint16_t current_ma;
+    uint16_t outputs;     // Sol_get_output_bitmap() at the event
+    uint8_t code;         // Error_t
+} Event_t;
+
+// Counters, then one frame per ring entry (oldest first)
+#define EVENT_TELEMETRY_ENTRIES (2 + EVENT_RING_SIZE)
+
+void Event_init(void);
+void Event_record(Error_t code, uint16_t current_ma, uint16_t outputs);
+void Event_persist(void);
+void Event_service(void);
+uint16_t Event_get_count(Error_t code);
+void Event_fill_frame(uint8_t entry, uint8_t *data);
+void Event_dump(void);
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,31 @@
+#ifndef FAULT_INJECT_H
+#define FAULT_INJECT_H
+
+#include "common.h"
+#include "config.h"
+
+#if FAULT_INJECTION_ENABLED && !defined(HOST_SIM)
+#error "Fault injection runs in the host simulation only, see host/Makefile"
+#endif
+
+#if FAULT_INJECTION_ENABLED
+// Implemented in host/fault_inject.c
+void Fault_init(void);
+void Fault_update(void);
+bool Fault_adc_forced(uint16_t *value);
+bool Fault_can_drop(void);
+bool Fault_can_duplicate(void);
+void Fault_note_error(uint8_t code);
+void Fault_note_safe(void);
+#else
+// Hooks compile away in production builds
+static inline void Fault_init(void) {}
+static inline void Fault_update(void) {}
+static inline bool Fault_adc_forced(uint16_t *value) { (void)value; return false; }
+static inline bool Fault_can_drop(void) { return false; }
+static inline bool Fault_can_duplicate(void) { return false; }
+static inline void Fault_note_error(uint8_t code) { (void)code; }
+static inline void Fault_note_safe(void) {}
+#endif
+
+#endif // FAULT_INJECT_H
@@ -0,0 +1,117 @@
+/*
+ * Host run of Bench_run(): the benchmark in benchmark.c against the
+ * peripheral model of sim.c, timed on the host clock and printed on
+ * stdout. Set BENCH_LOG to a candump log (candump -l) to add the recorded
+ * set, command frames on CAN_MSG_ID are replayed in order.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "benchmark.h"
+#include "profiler.h"
+#include "soft_timer.h"
+#include "led.h"
+#include "cmd_monitor.h"
+#include "mode_controller.h"
+#include "solenoid.h"
+#include "error_handler.h"
+#include "sim.h"
+
+#define BENCH_RECORDED_MAX 4096
+
+_Static_assert(BENCHMARK_ENABLED, "Build with BENCHMARK_ENABLED=1, see host/Makefile");
+
+static CAN_Message_t recorded[BENCH_RECORDED_MAX];
+static uint16_t recorded_count = 0;
+
+uint32_t Profile_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+uint16_t Bench_recorded_count(void) {
+    return recorded_count;
+}
+
+void Bench_recorded_frame(uint16_t n, CAN_Message_t *msg) {
+    *msg = recorded[n % recorded_count];
+}
+
+// "(1697040000.123456) can0 14FFFFB0#0102030405060708", other IDs skipped
+static void load_log(const char *path) {
+    char line[128];
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        perror(path);
+        Sim_finish(2);
+    }
+    while (recorded_count < BENCH_RECORDED_MAX && fgets(line, sizeof(line), file)) {
+        char iface[16];
+        char frame[40];
+        char *data;
+        CAN_Message_t *msg = &recorded[recorded_count];
+
+        if (sscanf(line, "(%*f) %15s %39s", iface, frame) != 2) continue;
+        data = frame;
+        msg->id = strtoul(frame, &data, 16);
+        if (*data != '#' || msg->id != CAN_MSG_ID) continue;
+
+        data++;
+        msg->length = 0;
+        for (uint8_t i = 0; i < 8; i++) {
+            unsigned int byte = 0;
+            if (data[0] && data[1] && sscanf(data, "%2x", &byte) == 1) {
+                data += 2;
+                msg->length++;
+            }
+            msg->data[i] = (uint8_t)byte;
+        }
+        recorded_count++;
+    }
+    fclose(file);
+}
+
+// Output of Bench_run(), the debug UART is not modelled
+void debug_init(void) {}
+
+void debug_print(const char *str) {
+    fputs(str, stdout);
+}
+
+void debug_println(const char *str) {
+    puts(str);
+}
+
+void debug_print_number(uint32_t num) {
+    printf("%lu", (unsigned long)num);
+}
+
+void debug_print_hex(uint8_t value) {
+    printf("0x%02X", value);
+}
+
+// Started by sim.c in place of the firmware main(), the modules the
+// measured paths touch come up as in system_init()
+int firmware_main(void) {
+    const char *log = getenv("BENCH_LOG");
+
+    if (log != NULL && *log) {
+        load_log(log);
+    }
+
+    Timer_init();
+    Profile_init();
+    LED_init();
+    Cmd_monitor_init();
+    CAN_init();
+    Mode_init();
+    Sol_init();
+    Err_init();
+
+    Bench_run();
+    Sim_finish(0);
+    return 0;
+}
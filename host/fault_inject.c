@@ -0,0 +1,212 @@
+#include "fault_inject.h"
+
+#include <stdio.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/delay.h>
+#include "soft_timer.h"
+#include "solenoid.h"
+#include "sim.h"
+
+_Static_assert(FAULT_INJECTION_ENABLED, "Build with FAULT_INJECTION_ENABLED=1, see host/Makefile");
+
+typedef enum {
+    FAULT_ADC_FORCE = 0,
+    FAULT_CAN_DROP,
+    FAULT_CAN_DUPLICATE,
+    FAULT_CAN_BUS_OFF,
+    FAULT_IRQ_STALL,
+    FAULT_EEPROM_FLIP
+} Fault_Type_t;
+
+#define FAULT_NO_REACTION 0xFFFF
+#define FAULT_NO_LIMIT 0xFFFF
+#define FAULT_REACTION_TIMEOUT_MS 5000  // Report "no reaction" after this
+
+#include "fault_script.h"
+
+typedef struct {
+    uint32_t at_ms;
+    Fault_Type_t type;
+    uint16_t arg;
+    uint16_t param;
+    uint16_t detect_max;
+    uint16_t safe_max;
+} Fault_Step_t;
+
+static const char *const type_names[] = {
+    "adc_force", "can_drop", "can_duplicate", "can_bus_off", "irq_stall", "eeprom_flip"
+};
+
+#define FAULT_STEP(at_ms, type, arg, param, detect_max, safe_max) \
+    { at_ms, type, arg, param, detect_max, safe_max },
+static const Fault_Step_t script[] = { FAULT_SCRIPT(FAULT_STEP) };
+#define FAULT_STEP_COUNT (sizeof(script) / sizeof(script[0]))
+
+static uint8_t next_step = 0;
+static volatile bool step_due = false;
+static Soft_Timer_t step_timer;
+static Soft_Timer_t end_timer;
+
+// Active overrides, read from the ADC path and the CAN ISR
+static volatile bool adc_forced = false;
+static volatile uint16_t adc_value = 0;
+static volatile bool can_drop = false;
+static volatile bool can_duplicate = false;
+
+// Reaction of the step under measurement, ms after injection
+static bool measuring = false;
+static uint8_t measured_step = 0;
+static uint32_t injected_at = 0;
+static uint16_t detect_ms = FAULT_NO_REACTION;
+static uint16_t safe_ms = FAULT_NO_REACTION;
+static uint8_t failures = 0;
+
+static void step_expired(void *arg) {
+    (void)arg;
+    step_due = true;
+}
+
+static void overrides_end(void *arg) {
+    (void)arg;
+    adc_forced = false;
+    can_drop = false;
+    can_duplicate = false;
+}
+
+static void schedule_next(void) {
+    uint32_t now = Timer_now();
+
+    if (next_step >= FAULT_STEP_COUNT) {
+        return;
+    }
+    Timer_arm(&step_timer, (script[next_step].at_ms > now) ? script[next_step].at_ms - now : 1, 0);
+}
+
+static void run_step(const Fault_Step_t *step) {
+    switch (step->type) {
+        case FAULT_ADC_FORCE:
+            adc_value = step->arg;
+            adc_forced = true;
+            Timer_arm(&end_timer, step->param, 0);
+            break;
+        case FAULT_CAN_DROP:
+            can_drop = true;
+            Timer_arm(&end_timer, step->param, 0);
+            break;
+        case FAULT_CAN_DUPLICATE:
+            can_duplicate = true;
+            Timer_arm(&end_timer, step->param, 0);
+            break;
+        case FAULT_CAN_BUS_OFF:
+            Sim_can_bus_off(step->param);
+            break;
+        case FAULT_IRQ_STALL:
+            cli();
+            for (uint16_t i = 0; i < step->param; i++) {
+                _delay_ms(1);
+            }
+            sei();
+            break;
+        case FAULT_EEPROM_FLIP: {
+            uint8_t *addr = (uint8_t *)(uintptr_t)step->arg;
+            eeprom_update_byte(addr, eeprom_read_byte(addr) ^ (uint8_t)step->param);
+            break;
+        }
+    }
+}
+
+static bool within(uint16_t ms, uint16_t max) {
+    return max == FAULT_NO_LIMIT || ms <= max;
+}
+
+static void print_ms(const char *label, uint16_t ms, uint16_t max) {
+    if (ms == FAULT_NO_REACTION) printf(" %s none", label);
+    else printf(" %s %u ms", label, ms);
+    if (max != FAULT_NO_LIMIT) printf(" (max %u)", max);
+}
+
+// One line per step, a reaction slower than its limit fails the run
+static void report(void) {
+    const Fault_Step_t *step = &script[measured_step];
+    bool ok = within(detect_ms, step->detect_max) && within(safe_ms, step->safe_max);
+
+    printf("step %u %-13s at %5lu ms:", measured_step, type_names[step->type],
+           (unsigned long)step->at_ms);
+    print_ms("detect", detect_ms, step->detect_max);
+    print_ms("safe", safe_ms, step->safe_max);
+    printf("  %s\n", ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+    if (measured_step == FAULT_STEP_COUNT - 1) {
+        printf("%u of %u steps failed\n", failures, (unsigned)FAULT_STEP_COUNT);
+        Sim_finish(failures ? 1 : 0);
+    }
+}
+
+void Fault_init(void) {
+    Timer_setup(&step_timer, step_expired, NULL);
+    Timer_setup(&end_timer, overrides_end, NULL);
+    next_step = 0;
+    schedule_next();
+}
+
+void Fault_update(void) {
+    if (measuring &&
+        ((detect_ms != FAULT_NO_REACTION && safe_ms != FAULT_NO_REACTION) ||
+         (Timer_now() - injected_at) > FAULT_REACTION_TIMEOUT_MS)) {
+        report();
+        measuring = false;
+    }
+
+    if (!step_due) {
+        return;
+    }
+    step_due = false;
+
+    if (measuring) {
+        report();  // Previous step cut short
+    }
+    measured_step = next_step;
+    injected_at = Timer_now();
+    detect_ms = FAULT_NO_REACTION;
+    // Nothing to make safe while every output is already off
+    safe_ms = (Sol_get_output_bitmap() == 0) ? 0 : FAULT_NO_REACTION;
+    measuring = true;
+
+    run_step(&script[next_step]);
+    next_step++;
+    schedule_next();
+}
+
+bool Fault_adc_forced(uint16_t *value) {
+    if (!adc_forced) {
+        return false;
+    }
+    *value = adc_value;
+    return true;
+}
+
+bool Fault_can_drop(void) {
+    return can_drop;
+}
+
+bool Fault_can_duplicate(void) {
+    return can_duplicate;
+}
+
+// First error raised after the injection
+void Fault_note_error(uint8_t code) {
+    (void)code;
+    if (measuring && detect_ms == FAULT_NO_REACTION) {
+        detect_ms = (uint16_t)(Timer_now() - injected_at);
+    }
+}
+
+// Outputs dropped to the safe state
+void Fault_note_safe(void) {
+    if (measuring && safe_ms == FAULT_NO_REACTION) {
+        safe_ms = (uint16_t)(Timer_now() - injected_at);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef FAULT_SCRIPT_H
+#define FAULT_SCRIPT_H
+
+/*
+ * Fault injection script for the host simulation. Each step is
+ * X(at_ms, type, arg, param, detect_max, safe_max), at_ms counted from
+ * start-up, with the master holding a function from 2 s on:
+ *   FAULT_ADC_FORCE      arg = raw ADC value, param = duration in ms
+ *   FAULT_CAN_DROP       param = duration in ms, command frames vanish
+ *   FAULT_CAN_DUPLICATE  param = duration in ms, command frames arrive twice
+ *   FAULT_CAN_BUS_OFF    param = ms the bus stays disturbed
+ *   FAULT_IRQ_STALL      param = ms with interrupts disabled
+ *   FAULT_EEPROM_FLIP    arg = EEPROM address, param = bits to flip
+ * detect_max and safe_max are the slowest accepted reactions in ms,
+ * FAULT_NO_LIMIT skips the check. EEPROM flips only show up on the next
+ * start, which one run does not cover.
+ *
+ * Over-current is only logged, Err_recover_from_error() leaves the
+ * outputs on, so that step has no safe-state limit.
+ */
+#define FAULT_SCRIPT(X) \
+    X(5000,  FAULT_ADC_FORCE,     1023, 1000, 110, FAULT_NO_LIMIT) \
+    X(15000, FAULT_CAN_DROP,      0,    2000, CMD_TIMEOUT_MS + 20, CMD_TIMEOUT_MS + 20) \
+    X(25000, FAULT_CAN_DUPLICATE, 0,    1000, FAULT_NO_LIMIT, FAULT_NO_LIMIT) \
+    X(35000, FAULT_IRQ_STALL,     0,    20,   FAULT_NO_LIMIT, FAULT_NO_LIMIT) \
+    X(45000, FAULT_CAN_BUS_OFF,   0,    1000, 20, CMD_TIMEOUT_MS + 20)
+
+#endif // FAULT_SCRIPT_H
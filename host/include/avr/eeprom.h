@@ -0,0 +1,21 @@
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+// 4 KB EEPROM kept in host memory, erased to 0xFF at start-up
+#include <stdint.h>
+#include <stddef.h>
+
+#define EEMEM
+
+uint8_t eeprom_read_byte(const uint8_t *addr);
+uint16_t eeprom_read_word(const uint16_t *addr);
+uint32_t eeprom_read_dword(const uint32_t *addr);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_word(uint16_t *addr, uint16_t value);
+void eeprom_update_dword(uint32_t *addr, uint32_t value);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+int eeprom_is_ready(void);
+
+#endif // HOST_AVR_EEPROM_H
@@ -0,0 +1,10 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+// Vectors are plain functions, sim.c dispatches them while SREG I is set
+#define ISR(vector, ...) void vector(void); void vector(void)
+
+void sei(void);
+void cli(void);
+
+#endif // HOST_AVR_INTERRUPT_H
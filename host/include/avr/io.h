@@ -0,0 +1,187 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+/*
+ * AT90CAN128 registers for the host simulation. Plain registers are
+ * variables the peripheral model in sim.c reads and writes between
+ * firmware steps. The CAN MOb registers are paged through CANPAGE and go
+ * through accessors, so paging and CANMSG auto-increment behave as on
+ * the controller.
+ */
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define HOST_REG8_LIST(X) \
+    X(PORTA) X(PORTB) X(PORTC) X(PORTD) X(PORTE) X(PORTF) X(PORTG) \
+    X(DDRA) X(DDRB) X(DDRC) X(DDRD) X(DDRE) X(DDRF) X(DDRG) \
+    X(PINA) X(PINB) X(PINC) X(PIND) X(PINE) X(PINF) X(PING) \
+    X(SREG) X(MCUSR) X(SMCR) X(PRR) \
+    X(TCCR0A) X(OCR0A) X(TIMSK0) X(TIFR0) \
+    X(TCCR1A) X(TCCR1B) X(TIMSK1) X(TIFR1) \
+    X(TCCR2A) X(OCR2A) X(TCNT2) X(TIMSK2) \
+    X(TCCR3A) X(TCCR3B) X(TIMSK3) X(TIFR3) \
+    X(ADMUX) X(ADCSRA) X(ADCSRB) X(DIDR0) \
+    X(UBRR1H) X(UBRR1L) X(UCSR1A) X(UCSR1B) X(UCSR1C) X(UDR1) \
+    X(CANGCON) X(CANGSTA) X(CANGIT) X(CANGIE) X(CANIE1) X(CANIE2) \
+    X(CANBT1) X(CANBT2) X(CANBT3) X(CANTCON) X(CANTEC) X(CANREC) \
+    X(CANHPMOB) X(CANPAGE)
+
+#define HOST_REG16_LIST(X) \
+    X(OCR1A) X(TCNT1) X(OCR3A) X(TCNT3) X(ADC) X(UBRR1)
+
+#define HOST_REG_DECLARE8(name) extern volatile uint8_t name;
+#define HOST_REG_DECLARE16(name) extern volatile uint16_t name;
+HOST_REG8_LIST(HOST_REG_DECLARE8)
+HOST_REG16_LIST(HOST_REG_DECLARE16)
+
+// Message objects, selected by CANPAGE
+#define HOST_CAN_MOBS 15
+
+typedef struct {
+    uint8_t stmob;
+    uint8_t cdmob;
+    uint8_t idt[4];
+    uint8_t idm[4];
+    uint8_t msg[8];
+} Host_Can_Mob_t;
+
+Host_Can_Mob_t *host_can_mob(void);
+volatile uint8_t *host_can_msg(void);
+uint16_t host_can_sit(void);
+uint16_t host_can_en(void);
+
+#define CANSTMOB (host_can_mob()->stmob)
+#define CANCDMOB (host_can_mob()->cdmob)
+#define CANIDT1 (host_can_mob()->idt[0])
+#define CANIDT2 (host_can_mob()->idt[1])
+#define CANIDT3 (host_can_mob()->idt[2])
+#define CANIDT4 (host_can_mob()->idt[3])
+#define CANIDM1 (host_can_mob()->idm[0])
+#define CANIDM2 (host_can_mob()->idm[1])
+#define CANIDM3 (host_can_mob()->idm[2])
+#define CANIDM4 (host_can_mob()->idm[3])
+#define CANMSG (*host_can_msg())
+#define CANSIT1 ((uint8_t)(host_can_sit() >> 8))
+#define CANSIT2 ((uint8_t)host_can_sit())
+#define CANEN1 ((uint8_t)(host_can_en() >> 8))
+#define CANEN2 ((uint8_t)host_can_en())
+
+// CANGCON
+#define SWRES 0
+#define ENASTB 1
+#define TEST 2
+#define LISTEN 3
+#define ABRQ 7
+// CANGIE
+#define ENERG 1
+#define ENBX 2
+#define ENERR 3
+#define ENTX 4
+#define ENRX 5
+#define ENBOFF 6
+#define ENIT 7
+// CANGIT
+#define AERG 0
+#define FERG 1
+#define CERG 2
+#define SERG 3
+#define BXOK 4
+#define OVRTIM 5
+#define BOFFIT 6
+#define CANIT 7
+// CANGSTA
+#define ERRP 0
+#define BOFF 1
+#define ENFG 2
+// CANCDMOB
+#define DLC0 0
+#define IDE 4
+#define RPLV 5
+#define CONMOB0 6
+#define CONMOB1 7
+// CANSTMOB
+#define AERR 0
+#define FERR 1
+#define CERR 2
+#define SERR 3
+#define BERR 4
+#define RXOK 5
+#define TXOK 6
+#define DLCW 7
+// CANPAGE, CANIE2, CANSIT2, CANEN2, CANIDM4
+#define INDX0 0
+#define AINC 3
+#define MOBNB0 4
+#define IEMOB0 0
+#define IEMOB1 1
+#define IEMOB2 2
+#define IEMOB3 3
+#define SIT0 0
+#define SIT1 1
+#define SIT2 2
+#define SIT3 3
+#define ENMOB0 0
+#define ENMOB1 1
+#define IDEMSK 0
+#define RTRMSK 2
+
+// USART1
+#define U2X1 1
+#define UDRE1 5
+#define UCSZ10 1
+#define UCSZ11 2
+#define TXEN1 3
+#define RXEN1 4
+#define UDRIE1 5
+
+// Timers
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM01 3
+#define OCF0A 1
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define OCIE1A 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM21 3
+#define OCIE2A 1
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define TOIE3 0
+#define TOV3 0
+
+// ADC
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+#define REFS0 6
+#define REFS1 7
+
+// MCUSR
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define JTRF 4
+
+#define PF0 0
+#define PF1 1
+#define PF2 2
+#define PF3 3
+
+#endif // HOST_AVR_IO_H
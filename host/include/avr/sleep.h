@@ -0,0 +1,13 @@
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+// sleep_cpu() advances the simulated clock to the next interrupt
+#include <stdint.h>
+#define SLEEP_MODE_IDLE 0
+
+void set_sleep_mode(uint8_t mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+
+#endif // HOST_AVR_SLEEP_H
@@ -0,0 +1,9 @@
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+// Busy waits advance the simulated clock, interrupts stay pending while
+// SREG I is clear
+void _delay_ms(double ms);
+void _delay_us(double us);
+
+#endif // HOST_UTIL_DELAY_H
@@ -0,0 +1,525 @@
+/*
+ * Host simulation of the valve node: the unmodified firmware runs against
+ * a model of the peripherals it uses.
+ *
+ *   clock    Advances only while the firmware sleeps or busy-waits, in
+ *            steps to the next peripheral event. Code runs in zero time.
+ *   irq      One pending flag per vector, dispatched in vector order
+ *            while SREG I is set, like the AVR flags.
+ *   timers   Timer1 tick, Timer2 PWM step and Timer0 ADC trigger from
+ *            their registers, TCNT3 follows the clock at F_CPU / 8 and
+ *            overflows with TOV3 set until the vector runs.
+ *   adc      Every energized coil draws SIM_COIL_MA through the sense
+ *            inputs of BOARD_ADC_LIST.
+ *   can      15 MObs with acceptance filters. A master sends a command
+ *            frame every SIM_CMD_PERIOD_MS holding SIM_HELD_FUNCTION,
+ *            transmitted frames complete at the next clock step.
+ *   eeprom   4 KB erased to 0xFF, writes complete at once.
+ *
+ * Debug output, the watchdog and SRAM monitoring are not modelled.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
+#include "config.h"
+#include "board.h"
+#include "can_lookup.h"
+#include "mem_monitor.h"
+#include "sim.h"
+
+#define SIM_COIL_MA 1500
+#define SIM_CMD_PERIOD_MS 20
+#define SIM_HELD_FUNCTION FUNCTION_C
+#define SIM_HOLD_FROM_MS 2000
+#define SIM_MAX_MS 600000UL    // Give up on a firmware that never finishes
+
+#define NS_PER_MS 1000000ULL
+
+_Static_assert(IDLE_SLEEP_ENABLED, "The simulated clock advances in sleep_cpu()");
+
+#define HOST_REG_DEFINE8(name) volatile uint8_t name;
+#define HOST_REG_DEFINE16(name) volatile uint16_t name;
+HOST_REG8_LIST(HOST_REG_DEFINE8)
+HOST_REG16_LIST(HOST_REG_DEFINE16)
+
+// Firmware entry, Main.c is built with main renamed
+int firmware_main(void);
+
+// Vectors in AVR priority order, weak where a feature may be compiled out
+void TIMER2_COMP_vect(void) __attribute__((weak));
+void TIMER1_COMPA_vect(void) __attribute__((weak));
+void CANIT_vect(void) __attribute__((weak));
+void ADC_vect(void) __attribute__((weak));
+void TIMER3_OVF_vect(void) __attribute__((weak));
+void USART1_UDRE_vect(void) __attribute__((weak));
+
+typedef enum {
+    SIM_IRQ_TIMER2 = 0,
+    SIM_IRQ_TIMER1,
+    SIM_IRQ_CAN,
+    SIM_IRQ_ADC,
+    SIM_IRQ_TIMER3_OVF,
+    SIM_IRQ_UDRE,
+    SIM_IRQ_COUNT
+} Sim_Irq_t;
+
+static void (*const vectors[SIM_IRQ_COUNT])(void) = {
+    TIMER2_COMP_vect, TIMER1_COMPA_vect, CANIT_vect, ADC_vect, TIMER3_OVF_vect,
+    USART1_UDRE_vect
+};
+
+static uint64_t now_ns = 0;
+static uint64_t next_ns[SIM_IRQ_COUNT];  // 0 while the source is off
+static uint64_t next_cmd_ns = 0;
+static uint8_t irq_pending = 0;
+static bool in_isr = false;
+static uint32_t isr_count = 0;
+static bool woken = false;               // An ISR ran in the sei() before sleep_cpu()
+
+static Host_Can_Mob_t mobs[HOST_CAN_MOBS];
+static uint8_t cmd_sequence = 0;
+static uint64_t bus_fault_until_ns = 0;
+static bool controller_on = false;
+
+static uint8_t eeprom[4096];
+
+// Prescaler tables indexed by the CSn2..0 bits
+static const uint16_t prescale_01[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint16_t prescale_2[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+uint32_t Sim_now_ms(void) {
+    return (uint32_t)(now_ns / NS_PER_MS);
+}
+
+void Sim_finish(int code) {
+    fflush(stdout);
+    exit(code);
+}
+
+// Period of a source in ns, 0 while it cannot interrupt
+static uint64_t irq_period_ns(Sim_Irq_t irq) {
+    uint32_t cycles = 0;
+
+    switch (irq) {
+        case SIM_IRQ_TIMER2:
+            if (TIMSK2 & (1 << OCIE2A)) {
+                cycles = (uint32_t)(OCR2A + 1) * prescale_2[TCCR2A & 0x07];
+            }
+            break;
+        case SIM_IRQ_TIMER1:
+            if (TIMSK1 & (1 << OCIE1A)) {
+                cycles = (uint32_t)(OCR1A + 1) * prescale_01[TCCR1B & 0x07];
+            }
+            break;
+        case SIM_IRQ_ADC:
+            // Conversions triggered by the Timer0 compare match
+            if ((ADCSRA & ((1 << ADEN) | (1 << ADATE) | (1 << ADIE))) ==
+                ((1 << ADEN) | (1 << ADATE) | (1 << ADIE))) {
+                cycles = (uint32_t)(OCR0A + 1) * prescale_01[TCCR0A & 0x07];
+            }
+            break;
+        case SIM_IRQ_TIMER3_OVF:
+            if (TIMSK3 & (1 << TOIE3)) {
+                cycles = 65536UL * prescale_01[TCCR3B & 0x07];
+            }
+            break;
+        case SIM_IRQ_UDRE:
+            if (UCSR1B & (1 << UDRIE1)) {
+                uint16_t ubrr = ((uint16_t)UBRR1H << 8) | UBRR1L;
+                cycles = 10UL * ((UCSR1A & (1 << U2X1)) ? 8 : 16) * (ubrr + 1);
+            }
+            break;
+        default:
+            break;
+    }
+    return (uint64_t)cycles * 1000000000ULL / F_CPU;
+}
+
+// ---- Current sense ----
+
+#define SIM_COIL_BIT(name, port, bit) | ((uint16_t)((PORT##port >> (bit)) & 1) << FUNCTION_##name)
+#define SIM_ADC_VALUE(name, ch, scale, zero, limit, coils) \
+    if ((ADMUX & 0x1F) == (ch)) { \
+        uint32_t counts = (zero) + ((uint32_t)sim_coil_count(energized & (coils)) * SIM_COIL_MA << 8) / (scale); \
+        return (counts > 1023) ? 1023 : (uint16_t)counts; \
+    }
+
+static uint8_t sim_coil_count(uint16_t bits) {
+    uint8_t count = 0;
+    while (bits) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+static uint16_t adc_convert(void) {
+    uint16_t energized = 0 BOARD_SOLENOID_LIST(SIM_COIL_BIT);
+
+    BOARD_ADC_LIST(SIM_ADC_VALUE)
+    return 0;
+}
+
+// ---- CAN controller ----
+
+Host_Can_Mob_t *host_can_mob(void) {
+    return &mobs[(CANPAGE >> MOBNB0) % HOST_CAN_MOBS];
+}
+
+volatile uint8_t *host_can_msg(void) {
+    Host_Can_Mob_t *mob = host_can_mob();
+    uint8_t index = CANPAGE & 0x07;
+
+    if (!(CANPAGE & (1 << AINC))) {
+        CANPAGE = (CANPAGE & 0xF8) | ((index + 1) & 0x07);
+    }
+    return &mob->msg[index];
+}
+
+// MObs with a flag raised and their interrupt enabled
+uint16_t host_can_sit(void) {
+    uint16_t enabled = ((uint16_t)CANIE1 << 8) | CANIE2;
+    uint16_t sit = 0;
+
+    for (uint8_t i = 0; i < HOST_CAN_MOBS; i++) {
+        if ((mobs[i].stmob & ((1 << RXOK) | (1 << TXOK))) && (enabled & (1 << i))) {
+            sit |= (1 << i);
+        }
+    }
+    return sit;
+}
+
+// MObs busy receiving or transmitting
+uint16_t host_can_en(void) {
+    uint16_t en = 0;
+
+    for (uint8_t i = 0; i < HOST_CAN_MOBS; i++) {
+        if (mobs[i].cdmob & ((1 << CONMOB1) | (1 << CONMOB0))) {
+            en |= (1 << i);
+        }
+    }
+    return en;
+}
+
+static uint32_t mob_id(const uint8_t *reg) {
+    return ((uint32_t)reg[0] << 21) | ((uint32_t)reg[1] << 13) |
+           ((uint32_t)reg[2] << 5) | (reg[3] >> 3);
+}
+
+static void can_raise(uint8_t enable) {
+    if ((CANGIE & (1 << ENIT)) && (CANGIE & enable)) {
+        irq_pending |= (1 << SIM_IRQ_CAN);
+    }
+}
+
+static bool bus_disturbed(void) {
+    return now_ns < bus_fault_until_ns;
+}
+
+static void can_enter_bus_off(void) {
+    CANGSTA |= (1 << BOFF);
+    CANTEC = 255;
+    CANGIT |= (1 << CANIT) | (1 << BOFFIT);
+    can_raise(1 << ENBOFF);
+}
+
+// A frame on the bus, taken by the first enabled MOb whose filter matches
+static void can_receive(uint32_t id, const uint8_t *data, uint8_t length) {
+    if (!controller_on || (CANGSTA & (1 << BOFF)) || bus_disturbed()) {
+        return;
+    }
+    for (uint8_t i = 0; i < HOST_CAN_MOBS; i++) {
+        Host_Can_Mob_t *mob = &mobs[i];
+
+        if ((mob->cdmob >> CONMOB0) != 2 || !(mob->cdmob & (1 << IDE)) ||
+            ((id ^ mob_id(mob->idt)) & mob_id(mob->idm) & 0x1FFFFFFFUL) != 0) {
+            continue;
+        }
+        mob->idt[0] = (uint8_t)(id >> 21);
+        mob->idt[1] = (uint8_t)(id >> 13);
+        mob->idt[2] = (uint8_t)(id >> 5);
+        mob->idt[3] = (uint8_t)(id << 3);
+        memcpy(mob->msg, data, 8);
+        mob->cdmob = (1 << IDE) | length;  // Done, the MOb is disabled
+        mob->stmob |= (1 << RXOK);
+        if ((((uint16_t)CANIE1 << 8) | CANIE2) & (1 << i)) {
+            can_raise(1 << ENRX);
+        }
+        return;
+    }
+}
+
+// Controller enable edges and transmissions, once per clock step
+static void can_step(void) {
+    bool on = (CANGCON & (1 << ENASTB)) != 0;
+
+    if (on && !controller_on) {
+        if (bus_disturbed() && (CANGSTA & (1 << BOFF))) {
+            can_enter_bus_off();  // Rejoined a bus that is still broken
+        } else {
+            CANGSTA &= ~(1 << BOFF);
+            CANTEC = 0;
+        }
+    }
+    controller_on = on;
+    if (!on || (CANGSTA & (1 << BOFF))) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < HOST_CAN_MOBS; i++) {
+        if ((mobs[i].cdmob >> CONMOB0) == 1) {
+            mobs[i].cdmob &= ~((1 << CONMOB1) | (1 << CONMOB0));
+            mobs[i].stmob |= (1 << TXOK);
+        }
+    }
+}
+
+void Sim_can_bus_off(uint16_t ms) {
+    bus_fault_until_ns = now_ns + ms * NS_PER_MS;
+    if (controller_on) {
+        can_enter_bus_off();
+    }
+}
+
+// The master's command frame, one signal bit per held function
+static void master_send(void) {
+    uint8_t data[8] = {0};
+
+    if (Sim_now_ms() >= SIM_HOLD_FROM_MS) {
+        const CAN_Lookup_Entry_t *entry = &can_lookup_table[SIM_HELD_FUNCTION];
+        data[entry->byte_index] |= entry->value;
+    }
+    data[7] = cmd_sequence++;
+    can_receive(CAN_MSG_ID, data, 8);
+}
+
+// ---- Interrupts and clock ----
+
+static bool dispatch(void) {
+    bool ran = false;
+
+    while ((SREG & 0x80) && !in_isr && irq_pending) {
+        uint8_t irq = 0;
+        while (!(irq_pending & (1 << irq))) {
+            irq++;
+        }
+        irq_pending &= ~(1 << irq);
+        if (irq == SIM_IRQ_ADC) {
+            ADC = adc_convert();
+        }
+        if (irq == SIM_IRQ_TIMER3_OVF) {
+            TIFR3 &= ~(1 << TOV3);
+        }
+        if (vectors[irq]) {
+            in_isr = true;
+            SREG &= ~0x80;
+            vectors[irq]();
+            SREG |= 0x80;
+            in_isr = false;
+            isr_count++;
+            ran = true;
+        }
+        if (irq == SIM_IRQ_CAN) {
+            // The ISR acknowledged its flags, write-one-to-clear
+            CANGIT = 0;
+            if (host_can_sit()) {
+                irq_pending |= (1 << SIM_IRQ_CAN);
+            }
+        }
+    }
+    return ran;
+}
+
+// Next event time, starting sources that were just switched on
+static uint64_t next_event(void) {
+    uint64_t next = next_cmd_ns;
+
+    for (uint8_t irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+        uint64_t period = irq_period_ns((Sim_Irq_t)irq);
+        if (period == 0) {
+            next_ns[irq] = 0;
+            continue;
+        }
+        if (next_ns[irq] == 0) {
+            // TCNT3 counts from reset, its overflows stay in phase with it
+            next_ns[irq] = (irq == SIM_IRQ_TIMER3_OVF) ? (now_ns / period + 1) * period
+                                                       : now_ns + period;
+        }
+        if (next_ns[irq] < next) {
+            next = next_ns[irq];
+        }
+    }
+    return next;
+}
+
+// Run the clock to `until`, raising every event on the way
+static void advance(uint64_t until) {
+    while (1) {
+        uint64_t next = next_event();
+
+        if (next > until) {
+            break;
+        }
+        now_ns = next;
+        TCNT3 = (uint16_t)(now_ns * (F_CPU / 8 / 1000000) / 1000);
+        for (uint8_t irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+            if (next_ns[irq] == now_ns) {
+                if (irq == SIM_IRQ_TIMER3_OVF) {
+                    TIFR3 |= (1 << TOV3);
+                }
+                irq_pending |= (1 << irq);
+                next_ns[irq] += irq_period_ns((Sim_Irq_t)irq);
+            }
+        }
+        if (next_cmd_ns == now_ns) {
+            master_send();
+            next_cmd_ns += SIM_CMD_PERIOD_MS * NS_PER_MS;
+        }
+        can_step();
+        dispatch();
+        if (Sim_now_ms() > SIM_MAX_MS) {
+            printf("sim: no verdict after %lu ms\n", SIM_MAX_MS);
+            Sim_finish(2);
+        }
+    }
+    now_ns = until;
+    TCNT3 = (uint16_t)(now_ns * (F_CPU / 8 / 1000000) / 1000);
+    can_step();
+}
+
+void sei(void) {
+    SREG |= 0x80;
+    if (dispatch()) {
+        woken = true;
+    }
+}
+
+void cli(void) {
+    SREG &= ~0x80;
+    woken = false;
+}
+
+void set_sleep_mode(uint8_t mode) {
+    (void)mode;
+}
+
+void sleep_enable(void) {
+}
+
+void sleep_disable(void) {
+}
+
+// Idle until the next interrupt has run
+void sleep_cpu(void) {
+    if (woken) {
+        woken = false;
+        return;
+    }
+    if (!(SREG & 0x80)) {
+        printf("sim: sleep with interrupts disabled at %lu ms\n", (unsigned long)Sim_now_ms());
+        Sim_finish(2);
+    }
+    uint32_t count = isr_count;
+
+    dispatch();
+    while (isr_count == count) {
+        advance(next_event());
+    }
+}
+
+void _delay_us(double us) {
+    advance(now_ns + (uint64_t)(us * 1000));
+}
+
+void _delay_ms(double ms) {
+    advance(now_ns + (uint64_t)(ms * NS_PER_MS));
+}
+
+// ---- EEPROM ----
+
+uint8_t eeprom_read_byte(const uint8_t *addr) {
+    return eeprom[(uintptr_t)addr % sizeof(eeprom)];
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr) {
+    const uint8_t *p = (const uint8_t *)addr;
+    return eeprom_read_byte(p) | ((uint16_t)eeprom_read_byte(p + 1) << 8);
+}
+
+uint32_t eeprom_read_dword(const uint32_t *addr) {
+    const uint16_t *p = (const uint16_t *)addr;
+    return eeprom_read_word(p) | ((uint32_t)eeprom_read_word(p + 1) << 16);
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+    }
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value) {
+    eeprom[(uintptr_t)addr % sizeof(eeprom)] = value;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value) {
+    eeprom_write_byte(addr, value);
+}
+
+void eeprom_update_word(uint16_t *addr, uint16_t value) {
+    eeprom_write_byte((uint8_t *)addr, (uint8_t)value);
+    eeprom_write_byte((uint8_t *)addr + 1, (uint8_t)(value >> 8));
+}
+
+void eeprom_update_dword(uint32_t *addr, uint32_t value) {
+    eeprom_update_word((uint16_t *)addr, (uint16_t)value);
+    eeprom_update_word((uint16_t *)addr + 1, (uint16_t)(value >> 16));
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+    }
+}
+
+int eeprom_is_ready(void) {
+    return 1;
+}
+
+// ---- SRAM monitor, needs the AVR linker symbols ----
+
+void Mem_init(void) {
+}
+
+void Mem_update(void) {
+}
+
+uint16_t Mem_get_static_usage(void) {
+    return 0;
+}
+
+uint16_t Mem_get_stack_peak(void) {
+    return 0;
+}
+
+uint16_t Mem_get_free_min(void) {
+    return 0;
+}
+
+void Mem_fill_frame(uint8_t *data) {
+    (void)data;
+}
+
+int main(void) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    MCUSR = (1 << PORF);
+    UCSR1A = (1 << UDRE1);  // The debug UART never holds the firmware up
+    next_cmd_ns = SIM_CMD_PERIOD_MS * NS_PER_MS;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return firmware_main();
+}
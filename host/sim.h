@@ -0,0 +1,16 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "common.h"
+
+// Simulated time since reset
+uint32_t Sim_now_ms(void);
+
+// Bus disturbed for ms: the controller goes bus-off and every rejoin
+// attempt fails again until the disturbance is over
+void Sim_can_bus_off(uint16_t ms);
+
+// End the run, the exit code is the verdict
+void Sim_finish(int code);
+
+#endif // SIM_H
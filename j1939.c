@@ -0,0 +1,224 @@
+#include "j1939.h"
+#include <avr/interrupt.h>
+#include "can.h"
+#include "solenoid.h"
+#include "error_handler.h"
+#include "soft_timer.h"
+#include "debug.h"
+#include "capture.h"
+
+#define J1939_RX_SIZE 4
+
+typedef enum {
+    J1939_CLAIMING = 0,  // Claim sent or pending, transmit nothing else
+    J1939_CLAIMED,
+    J1939_LOST           // No address available, node stays silent
+} J1939_State_t;
+
+// Network management frames, queued by the CAN ISR
+static volatile CAN_Message_t rx_queue[J1939_RX_SIZE];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+static volatile uint8_t rx_count = 0;
+
+static uint64_t name;
+static uint8_t address = J1939_ADDR_NULL;
+static uint8_t claim_attempts = 0;
+static bool claim_pending = false;
+static volatile J1939_State_t state = J1939_CLAIMING;
+static Soft_Timer_t settle_timer;
+
+void J1939_parse_id(uint32_t id, J1939_Id_t *out) {
+    uint8_t pf = (uint8_t)(id >> 16);
+
+    out->priority = (uint8_t)(id >> 26) & 0x07;
+    out->source = (uint8_t)id;
+    if (pf < 240) {
+        // PDU1: PS is the destination address
+        out->pgn = (id >> 8) & 0x3FF00UL;
+        out->dest = (uint8_t)(id >> 8);
+    } else {
+        // PDU2: PS is the group extension, always broadcast
+        out->pgn = (id >> 8) & 0x3FFFFUL;
+        out->dest = J1939_ADDR_GLOBAL;
+    }
+}
+
+uint32_t J1939_make_id(uint8_t priority, uint32_t pgn, uint8_t dest, uint8_t source) {
+    uint32_t id = ((uint32_t)(priority & 0x07) << 26) | ((pgn & 0x3FFFFUL) << 8) | source;
+
+    if (((pgn >> 8) & 0xFF) < 240) {
+        id = (id & ~0xFF00UL) | ((uint32_t)dest << 8);
+    }
+    return id;
+}
+
+static void settle_expired(void *arg) {
+    (void)arg;
+    if (state == J1939_CLAIMING) {
+        state = J1939_CLAIMED;
+    }
+}
+
+static Status_t send_claim(void) {
+    CAN_Message_t msg;
+
+    msg.id = J1939_make_id(J1939_PRIORITY_DEFAULT, J1939_PGN_ADDRESS_CLAIMED,
+                           J1939_ADDR_GLOBAL, address);
+    msg.length = 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        msg.data[i] = (uint8_t)(name >> (8 * i));
+    }
+    return CAN_send(&msg);
+}
+
+static void send_nack(uint8_t requester, uint32_t pgn) {
+    CAN_Message_t msg;
+
+    msg.id = J1939_make_id(J1939_PRIORITY_DEFAULT, J1939_PGN_ACKNOWLEDGMENT,
+                           J1939_ADDR_GLOBAL, address);
+    msg.length = 8;
+    msg.data[0] = 1;  // Control byte: NACK
+    msg.data[1] = 0xFF;
+    msg.data[2] = 0xFF;
+    msg.data[3] = 0xFF;
+    msg.data[4] = requester;
+    msg.data[5] = (uint8_t)pgn;
+    msg.data[6] = (uint8_t)(pgn >> 8);
+    msg.data[7] = (uint8_t)(pgn >> 16);
+    CAN_send(&msg);
+}
+
+// Lost arbitration on our address: move on through the dynamic range or give up
+static void claim_lost(void) {
+    if (J1939_ARBITRARY_ADDRESS_CAPABLE &&
+        claim_attempts < (J1939_ADDR_DYNAMIC_MAX - J1939_ADDR_DYNAMIC_MIN + 1)) {
+        claim_attempts++;
+        if (address < J1939_ADDR_DYNAMIC_MIN || address >= J1939_ADDR_DYNAMIC_MAX) {
+            address = J1939_ADDR_DYNAMIC_MIN;
+        } else {
+            address++;
+        }
+        state = J1939_CLAIMING;
+    } else {
+        address = J1939_ADDR_NULL;
+        state = J1939_LOST;
+    }
+    Timer_cancel(&settle_timer);
+    claim_pending = true;
+
+    DEBUG_PRINT("J1939 address: ");
+    DEBUG_PRINT_HEX(address);
+    DEBUG_PRINTLN("");
+}
+
+static void handle_address_claim(const J1939_Id_t *id, const uint8_t *data) {
+    uint64_t other = 0;
+
+    if (state == J1939_LOST || id->source != address) {
+        return;
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        other |= (uint64_t)data[i] << (8 * i);
+    }
+
+    // Lower NAME has priority
+    if (name < other) {
+        claim_pending = true;
+    } else {
+        claim_lost();
+    }
+}
+
+static void handle_request(const J1939_Id_t *id, const uint8_t *data, uint8_t length) {
+    uint32_t pgn;
+
+    if (length < 3 || (id->dest != address && id->dest != J1939_ADDR_GLOBAL)) {
+        return;
+    }
+    pgn = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16);
+
+    if (pgn == J1939_PGN_ADDRESS_CLAIMED) {
+        claim_pending = true;
+    } else if (state != J1939_CLAIMED) {
+        return;
+    } else if (pgn == J1939_PGN_STATUS) {
+        CAN_send_status(0xFF, Sol_get_output_bitmap(), Err_get_current_error());
+    } else if (pgn == J1939_PGN_CAPTURE) {
+        // Sent chunk by chunk from Capture_update, NACK while nothing is frozen
+        if (Capture_request_download() != SUCCESS && id->dest == address) {
+            send_nack(id->source, pgn);
+        }
+    } else if (id->dest == address) {
+        // Only destination specific requests are acknowledged
+        send_nack(id->source, pgn);
+    }
+}
+
+void J1939_init(uint8_t preferred_addr) {
+    // Identical firmware on several nodes must still give unique NAMEs
+    name = (J1939_NAME & ~0xFFULL) | preferred_addr;
+    address = preferred_addr;
+    claim_attempts = 0;
+    state = J1939_CLAIMING;
+    claim_pending = true;
+    Timer_setup(&settle_timer, settle_expired, NULL);
+}
+
+// Called from the CAN ISR for Request and Address Claimed frames
+void J1939_frame_received(uint32_t id, const uint8_t *data, uint8_t length) {
+    if (rx_count >= J1939_RX_SIZE) {
+        return;
+    }
+    rx_queue[rx_head].id = id;
+    rx_queue[rx_head].length = length;
+    for (uint8_t i = 0; i < 8; i++) {
+        rx_queue[rx_head].data[i] = data[i];
+    }
+    rx_head = (rx_head + 1) % J1939_RX_SIZE;
+    rx_count++;
+}
+
+void J1939_update(void) {
+    CAN_Message_t frame;
+    J1939_Id_t id;
+
+    while (1) {
+        cli();
+        if (rx_count == 0) {
+            sei();
+            break;
+        }
+        frame.id = rx_queue[rx_tail].id;
+        frame.length = rx_queue[rx_tail].length;
+        for (uint8_t i = 0; i < 8; i++) {
+            frame.data[i] = rx_queue[rx_tail].data[i];
+        }
+        rx_tail = (rx_tail + 1) % J1939_RX_SIZE;
+        rx_count--;
+        sei();
+
+        J1939_parse_id(frame.id, &id);
+        if (id.pgn == J1939_PGN_ADDRESS_CLAIMED) {
+            handle_address_claim(&id, frame.data);
+        } else if (id.pgn == J1939_PGN_REQUEST) {
+            handle_request(&id, frame.data, frame.length);
+        }
+    }
+
+    // Claims are retried here while the TX MOb is busy
+    if (claim_pending && send_claim() == SUCCESS) {
+        claim_pending = false;
+        if (state == J1939_CLAIMING && !Timer_is_armed(&settle_timer)) {
+            Timer_arm(&settle_timer, J1939_CLAIM_SETTLE_MS, 0);
+        }
+    }
+}
+
+uint8_t J1939_get_address(void) {
+    return address;
+}
+
+bool J1939_is_claimed(void) {
+    return state == J1939_CLAIMED;
+}
@@ -0,0 +1,50 @@
+#ifndef J1939_H
+#define J1939_H
+
+#include "common.h"
+#include "config.h"
+
+// 29-bit identifier layout: priority(3) EDP DP PF(8) PS(8) SA(8)
+#define J1939_PGN_REQUEST         0xEA00UL
+#define J1939_PGN_ADDRESS_CLAIMED 0xEE00UL
+#define J1939_PGN_ACKNOWLEDGMENT  0xE800UL
+#define J1939_PGN_STATUS          ((CAN_STATUS_ID_BASE >> 8) & 0x3FFFFUL)
+#define J1939_PGN_CAPTURE         ((CAN_CAPTURE_ID_BASE >> 8) & 0x3FFFFUL)
+
+#define J1939_ADDR_GLOBAL 0xFF
+#define J1939_ADDR_NULL   0xFE  // Source address of "cannot claim"
+#define J1939_ADDR_DYNAMIC_MIN 128  // Arbitrary address range
+#define J1939_ADDR_DYNAMIC_MAX 247
+
+#define J1939_PRIORITY_DEFAULT 6
+#define J1939_CLAIM_SETTLE_MS 250  // Silence required after a claim
+
+// Acceptance masks for the RX MObs, priority is never compared
+#define J1939_MASK_PGN_SA 0x03FFFFFFUL  // Exact PGN and source
+#define J1939_MASK_PF     0x03FF0000UL  // PDU1 PGN, any destination and source
+
+// NAME fields in address claim order
+#define J1939_NAME ( \
+    ((uint64_t)J1939_ARBITRARY_ADDRESS_CAPABLE << 63) | \
+    ((uint64_t)J1939_INDUSTRY_GROUP << 60) | \
+    ((uint64_t)J1939_FUNCTION << 40) | \
+    ((uint64_t)J1939_MANUFACTURER_CODE << 21) | \
+    ((uint64_t)J1939_IDENTITY_NUMBER & 0x1FFFFF))
+
+typedef struct {
+    uint8_t priority;
+    uint32_t pgn;       // PDU1 PGNs have the PS byte cleared
+    uint8_t dest;       // J1939_ADDR_GLOBAL for PDU2
+    uint8_t source;
+} J1939_Id_t;
+
+void J1939_parse_id(uint32_t id, J1939_Id_t *out);
+uint32_t J1939_make_id(uint8_t priority, uint32_t pgn, uint8_t dest, uint8_t source);
+
+void J1939_init(uint8_t preferred_addr);
+void J1939_frame_received(uint32_t id, const uint8_t *data, uint8_t length);
+void J1939_update(void);
+uint8_t J1939_get_address(void);
+bool J1939_is_claimed(void);
+
+#endif // J1939_H
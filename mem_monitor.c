@@ -0,0 +1,87 @@
+#include "mem_monitor.h"
+#include <avr/io.h>
+#include "debug.h"
+
+// Linker symbols provided by avr-libc
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+static uint16_t static_usage = 0;
+static uint16_t free_min = 0;
+
+void Mem_paint_stack(void) __attribute__((naked, used, section(".init1")));
+
+/**
+ * @brief Fill everything between the end of .bss and the top of the stack
+ *        with STACK_CANARY before the C runtime starts using SRAM
+ */
+void Mem_paint_stack(void)
+{
+    __asm__ __volatile__ (
+        "    ldi r30, lo8(_end)      \n"
+        "    ldi r31, hi8(_end)      \n"
+        "    ldi r24, %0             \n"
+        "    ldi r25, hi8(__stack)   \n"
+        "    rjmp 2f                 \n"
+        "1:  st Z+, r24              \n"
+        "2:  cpi r30, lo8(__stack)   \n"
+        "    cpc r31, r25            \n"
+        "    brlo 1b                 \n"
+        "    breq 1b                 \n"
+        :: "M" (STACK_CANARY));
+}
+
+void Mem_init(void) {
+    static_usage = (uint16_t)(&__data_end - &__data_start) +
+                   (uint16_t)(&__bss_end - &__bss_start);
+    free_min = (uint16_t)(&__stack - &_end) + 1;
+    Mem_update();
+
+    DEBUG_PRINT("SRAM static: ");
+    DEBUG_PRINT_NUM(static_usage);
+    DEBUG_PRINT(" stack peak: ");
+    DEBUG_PRINT_NUM(Mem_get_stack_peak());
+    DEBUG_PRINT(" free: ");
+    DEBUG_PRINT_NUM(free_min);
+    DEBUG_PRINTLN("");
+}
+
+// Stack grows down towards _end, so the untouched region is the run of
+// canary bytes starting at _end. Only the part still painted is rescanned.
+void Mem_update(void) {
+    const uint8_t *p = &_end;
+    uint16_t count = 0;
+
+    while (count < free_min && *p == STACK_CANARY) {
+        p++;
+        count++;
+    }
+    free_min = count;
+}
+
+uint16_t Mem_get_static_usage(void) {
+    return static_usage;
+}
+
+uint16_t Mem_get_stack_peak(void) {
+    return (uint16_t)(&__stack - &_end) + 1 - free_min;
+}
+
+uint16_t Mem_get_free_min(void) {
+    return free_min;
+}
+
+void Mem_fill_frame(uint8_t *data) {
+    uint16_t peak = Mem_get_stack_peak();
+
+    data[0] = (uint8_t)static_usage;
+    data[1] = (uint8_t)(static_usage >> 8);
+    data[2] = (uint8_t)peak;
+    data[3] = (uint8_t)(peak >> 8);
+    data[4] = (uint8_t)free_min;
+    data[5] = (uint8_t)(free_min >> 8);
+}
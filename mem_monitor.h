@@ -0,0 +1,14 @@
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include "common.h"
+#include "config.h"
+
+void Mem_init(void);
+void Mem_update(void);
+uint16_t Mem_get_static_usage(void);
+uint16_t Mem_get_stack_peak(void);
+uint16_t Mem_get_free_min(void);
+void Mem_fill_frame(uint8_t *data);
+
+#endif // MEM_MONITOR_H
@@ -4,11 +4,16 @@
 #include "can_lookup.h"
 #include "debug.h"
 #include "eeprom.h"
-#include "system_timer.h"
+#include "soft_timer.h"
 
 static Output_Mode_t pair_modes[PAIR_COUNT];
-static uint32_t mode_led_start_time = 0;
-static const uint16_t MODE_LED_TIMEOUT = 300; // 30 seconds in deciseconds
+static Soft_Timer_t mode_led_timer;
+static const uint16_t MODE_LED_TIMEOUT = 30000; // 30 seconds in ms
+
+static void mode_led_timeout(void *arg) {
+    (void)arg;
+    LED_set(LED_MODE, LED_OFF, 0);
+}
 
 void Mode_init(void) {
     DEBUG_PRINTLN("Initializing mode controller");
@@ -41,7 +46,7 @@ void Mode_init(void) {
     }
     
     // Initialize timer for LED
-    mode_led_start_time = 0;
+    Timer_setup(&mode_led_timer, mode_led_timeout, NULL);
 }
 
 void Mode_check_startup_key(void) {
@@ -82,7 +87,7 @@ void Mode_check_startup_key(void) {
     // If any key detected, turn on mode LED for 30 seconds
     if (key_detected) {
         LED_set(LED_MODE, LED_ON, 0);
-        mode_led_start_time = system_timer_get_ms();
+        Timer_arm(&mode_led_timer, MODE_LED_TIMEOUT, 0);
     } else {
         // No startup key detected, just read from EEPROM (already done in Mode_init)
         DEBUG_PRINTLN("No startup key detected, using stored modes from EEPROM");
@@ -99,7 +104,7 @@ void Mode_set_latch(Pair_t pair) {
     
     // Update LED to indicate mode change
     LED_set(LED_MODE, LED_ON, 0);
-    mode_led_start_time = system_timer_get_ms();
+    Timer_arm(&mode_led_timer, MODE_LED_TIMEOUT, 0);
     
     // Store to EEPROM if this is pair 1 or 6
     if (pair == PAIR_1) {
@@ -120,7 +125,7 @@ void Mode_set_momentary(Pair_t pair) {
     
     // Update LED to indicate mode change
     LED_set(LED_MODE, LED_ON, 0);
-    mode_led_start_time = system_timer_get_ms();
+    Timer_arm(&mode_led_timer, MODE_LED_TIMEOUT, 0);
     
     // Store to EEPROM if this is pair 1 or 6
     if (pair == PAIR_1) {
@@ -130,17 +135,6 @@ void Mode_set_momentary(Pair_t pair) {
     }
 }
 
-void Mode_store_prev(void) {
-    // Check if mode LED timeout has occurred
-    if (mode_led_start_time > 0) {
-        uint32_t current_time = system_timer_get_ms();
-        if ((current_time - mode_led_start_time) >= (MODE_LED_TIMEOUT * 100)) {
-            LED_set(LED_MODE, LED_OFF, 0);
-            mode_led_start_time = 0;
-        }
-    }
-}
-
 Output_Mode_t Mode_get_pair_mode(Pair_t pair) {
     if (pair < PAIR_COUNT) {
         return pair_modes[pair];
@@ -13,7 +13,6 @@ void Mode_init(void);
 void Mode_check_startup_key(void);
 void Mode_set_latch(Pair_t pair);
 void Mode_set_momentary(Pair_t pair);
-void Mode_store_prev(void);
 Output_Mode_t Mode_get_pair_mode(Pair_t pair);
 
 #endif // MODE_CONTROLLER_H
\ No newline at end of file
@@ -9,7 +9,7 @@
 #include "can_ctrl.h"
 #include "eeprom_ctrl.h"
 #include "LED_ctrl.h"
-#include "system_timer.h"
+#include "soft_timer.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
@@ -20,9 +20,18 @@ static Mode_t pair_modes[PAIR_COUNT];
 static bool mode_changed = false;
 
 // Timer for MODE LED indication
-static uint32_t mode_led_start_time = 0;
+static Soft_Timer_t mode_led_timer;
 static const uint16_t MODE_LED_TIMEOUT = 30000; // 30 seconds in ms
 
+/**
+ * @brief Turn the MODE LED off once the indication time has elapsed
+ */
+static void Mode_LedTimeout(void *arg)
+{
+    (void)arg;
+    LED_Set(LED4_GREEN, OFF, 0);
+}
+
 /**
  * @brief Initialize mode controller
  */
@@ -37,7 +46,7 @@ void Mode_Init(void)
     mode_changed = false;
     
     // Initialize timer
-    mode_led_start_time = 0;
+    Timer_setup(&mode_led_timer, Mode_LedTimeout, NULL);
 }
 
 /**
@@ -76,7 +85,7 @@ void Mode_CheckStartupKey(void)
     // If any mode key was pressed, turn on mode LED for 30 seconds
     if (mode_key_pressed) {
         LED_Set(LED4_GREEN, ON, 0);
-        mode_led_start_time = Timer_GetMillis();
+        Timer_arm(&mode_led_timer, MODE_LED_TIMEOUT, 0);
         mode_changed = true;
     }
 }
@@ -123,15 +132,6 @@ void Mode_StorePrev(void)
         }
         mode_changed = false;
     }
-    
-    // Update mode LED status
-    if (mode_led_start_time > 0) {
-        uint32_t current_time = Timer_GetMillis();
-        if ((current_time - mode_led_start_time) >= MODE_LED_TIMEOUT) {
-            LED_Set(LED4_GREEN, OFF, 0);
-            mode_led_start_time = 0;
-        }
-    }
 }
 
 /**
@@ -0,0 +1,128 @@
+#include "profiler.h"
+#include <avr/interrupt.h>
+#include "debug.h"
+#include "cpu_load.h"
+
+static volatile Profile_Stats_t profile_stats[PROF_COUNT];
+volatile uint16_t profile_overflows = 0;
+
+static const char *const profile_names[PROF_COUNT] = {
+    "CAN_process",
+    "Sol_set_output",
+    "LED_update",
+    "ISR_CAN",
+    "ISR_TIMER"
+};
+
+void Profile_init(void) {
+    // Timer3 normal mode, prescaler 8, free running, overflows extend it
+    TCCR3A = 0;
+    TCCR3B = (1 << CS31);
+    TIMSK3 = (1 << TOIE3);
+
+    Profile_reset();
+}
+
+ISR(TIMER3_OVF_vect) {
+    Load_isr_enter();
+    profile_overflows++;
+}
+
+void Profile_record(Profile_Region_t region, uint32_t ticks) {
+    if (region >= PROF_COUNT) return;
+
+    // May be called from ISRs and main loop alike
+    uint8_t sreg = SREG;
+    cli();
+    volatile Profile_Stats_t *stats = &profile_stats[region];
+    if (stats->sum > UINT32_MAX - ticks) {
+        // Halve both so the average survives a window that is too long
+        stats->sum >>= 1;
+        stats->count >>= 1;
+    }
+    stats->count++;
+    stats->sum += ticks;
+    if (ticks < stats->min) stats->min = ticks;
+    if (ticks > stats->max) stats->max = ticks;
+    SREG = sreg;
+}
+
+void Profile_get(Profile_Region_t region, Profile_Stats_t *stats) {
+    if (region >= PROF_COUNT) return;
+
+    uint8_t sreg = SREG;
+    cli();
+    stats->count = profile_stats[region].count;
+    stats->sum = profile_stats[region].sum;
+    stats->min = profile_stats[region].min;
+    stats->max = profile_stats[region].max;
+    SREG = sreg;
+}
+
+void Profile_reset(void) {
+    uint8_t sreg = SREG;
+    cli();
+    for (uint8_t i = 0; i < PROF_COUNT; i++) {
+        profile_stats[i].count = 0;
+        profile_stats[i].sum = 0;
+        profile_stats[i].min = UINT32_MAX;
+        profile_stats[i].max = 0;
+    }
+    SREG = sreg;
+}
+
+// Frame fields are 16 bits, longer regions report 0xFFFF
+static uint16_t frame_ticks(uint32_t ticks) {
+    return (ticks > 0xFFFF) ? 0xFFFF : (uint16_t)ticks;
+}
+
+// Ticks to microseconds without overflowing 32 bits
+static uint32_t ticks_to_us(uint32_t ticks) {
+    return ticks / 1000 * PROFILE_TICK_NS + ticks % 1000 * PROFILE_TICK_NS / 1000;
+}
+
+// Pack min/avg/max ticks of one region into 7 bytes of a diagnostic frame
+void Profile_fill_frame(Profile_Region_t region, uint8_t *data) {
+    Profile_Stats_t stats;
+    uint16_t avg = 0;
+
+    Profile_get(region, &stats);
+    if (stats.count > 0) {
+        avg = frame_ticks(stats.sum / stats.count);
+    } else {
+        stats.min = 0;
+    }
+    stats.min = frame_ticks(stats.min);
+    stats.max = frame_ticks(stats.max);
+
+    data[0] = region;
+    data[1] = (uint8_t)stats.min;
+    data[2] = (uint8_t)(stats.min >> 8);
+    data[3] = (uint8_t)avg;
+    data[4] = (uint8_t)(avg >> 8);
+    data[5] = (uint8_t)stats.max;
+    data[6] = (uint8_t)(stats.max >> 8);
+}
+
+// Print and start a new window, telemetry then reports the same window
+void Profile_dump(void) {
+    Profile_Stats_t stats;
+
+    DEBUG_PRINTLN("Profile (min/avg/max in us):");
+    for (uint8_t i = 0; i < PROF_COUNT; i++) {
+        Profile_get((Profile_Region_t)i, &stats);
+        if (stats.count == 0) continue;
+
+        DEBUG_PRINT(profile_names[i]);
+        DEBUG_PRINT(" n=");
+        DEBUG_PRINT_NUM(stats.count);
+        DEBUG_PRINT(" ");
+        DEBUG_PRINT_NUM(ticks_to_us(stats.min));
+        DEBUG_PRINT("/");
+        DEBUG_PRINT_NUM(ticks_to_us(stats.sum / stats.count));
+        DEBUG_PRINT("/");
+        DEBUG_PRINT_NUM(ticks_to_us(stats.max));
+        DEBUG_PRINTLN("");
+    }
+    Profile_reset();
+}
@@ -0,0 +1,71 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "common.h"
+#include "config.h"
+
+// Timer3 free-runs at F_CPU/8, one tick is 0.5us @ 16MHz. It wraps every
+// 32.768 ms, shorter than a few debug prints at DEBUG_UART_BAUD, so its
+// overflows are counted to extend it to 32 bits (35 minutes)
+#ifdef HOST_BENCH
+#define PROFILE_TICK_NS 1UL  // host/bench.c reads the host clock in ns
+#else
+#define PROFILE_TICK_NS (8000000000UL / F_CPU)
+#endif
+
+typedef enum {
+    PROF_CAN_PROCESS = 0,
+    PROF_SOL_SET_OUTPUT,
+    PROF_LED_UPDATE,
+    PROF_ISR_CAN,
+    PROF_ISR_TIMER,
+    PROF_COUNT
+} Profile_Region_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t sum;
+    uint32_t min;
+    uint32_t max;
+} Profile_Stats_t;
+
+extern volatile uint16_t profile_overflows;
+
+void Profile_init(void);
+void Profile_record(Profile_Region_t region, uint32_t ticks);
+void Profile_get(Profile_Region_t region, Profile_Stats_t *stats);
+void Profile_reset(void);
+void Profile_fill_frame(Profile_Region_t region, uint8_t *data);
+void Profile_dump(void);
+
+#ifdef HOST_BENCH
+uint32_t Profile_now(void);
+#else
+// Read TCNT3 with interrupts held off, an ISR touching TCNT3 would corrupt TEMP
+static inline uint32_t Profile_now(void) {
+    uint8_t sreg = SREG;
+    uint16_t high;
+    uint16_t ticks;
+    cli();
+    ticks = TCNT3;
+    high = profile_overflows;
+    // An overflow not serviced yet, e.g. inside an ISR, belongs to this reading
+    if ((TIFR3 & (1 << TOV3)) && ticks < 0x8000) {
+        high++;
+    }
+    SREG = sreg;
+    return ((uint32_t)high << 16) | ticks;
+}
+#endif
+
+#if PROFILING_ENABLED
+#define PROFILE_BEGIN(id) uint32_t profile_start_##id = Profile_now()
+#define PROFILE_END(id) Profile_record((id), Profile_now() - profile_start_##id)
+#else
+#define PROFILE_BEGIN(id) ((void)0)
+#define PROFILE_END(id) ((void)0)
+#endif
+
+#endif // PROFILER_H
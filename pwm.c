@@ -0,0 +1,101 @@
+#include "pwm.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "board.h"
+#include "cpu_load.h"
+
+// Timer2 CTC at /64, one compare match per PWM step
+#define PWM_PRESCALER 64
+#define PWM_OCR (F_CPU / PWM_PRESCALER / ((uint32_t)PWM_FREQ_HZ * PWM_STEPS) - 1)
+// Duty change per period so a full 0-255 swing takes at least PWM_RAMP_MS
+#define PWM_RAMP_STEP ((255UL * 1000 / PWM_FREQ_HZ + PWM_RAMP_MS - 1) / PWM_RAMP_MS)
+
+_Static_assert(PWM_OCR >= 1 && PWM_OCR <= 255, "PWM_FREQ_HZ * PWM_STEPS outside Timer2 range");
+_Static_assert(PWM_STEPS >= 2 && PWM_STEPS <= 255, "PWM_STEPS must fit the 8-bit phase");
+_Static_assert(PWM_RAMP_STEP >= 1 && PWM_RAMP_STEP <= 255, "PWM_RAMP_MS out of range");
+
+#define PWM_CASE_WRITE(name, port, bit) BOARD_CASE_WRITE(FUNCTION_##name, port, bit)
+
+static uint16_t pwm_mask = 0;                  // Functions driven by the ISR
+static volatile uint8_t target[FUNCTION_COUNT];
+static volatile uint8_t level[FUNCTION_COUNT]; // Ramped duty, ISR owned
+static uint8_t on_steps[FUNCTION_COUNT];       // level scaled to PWM_STEPS
+static uint8_t phase = 0;
+
+static void pwm_write(uint8_t function, bool on) {
+    switch (function) {
+        BOARD_SOLENOID_LIST(PWM_CASE_WRITE)
+        default: break;
+    }
+}
+
+void Pwm_init(uint16_t mask) {
+    pwm_mask = mask;
+    for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+        target[f] = 0;
+        level[f] = 0;
+        on_steps[f] = 0;
+    }
+    if (mask == 0) {
+        return;  // Timer2 stays off, no ISR load without proportional outputs
+    }
+    TCCR2A = (1 << WGM21) | (1 << CS22);  // CTC, prescaler 64
+    OCR2A = PWM_OCR;
+    TIMSK2 = (1 << OCIE2A);
+}
+
+// Zero switches the coil off at once, other changes are ramped by the ISR
+void Pwm_set(Function_t function, uint8_t duty) {
+    uint8_t sreg;
+
+    if (function >= FUNCTION_COUNT || !(pwm_mask & (1 << function))) {
+        return;
+    }
+    sreg = SREG;
+    cli();
+    target[function] = duty;
+    if (duty == 0) {
+        level[function] = 0;
+        on_steps[function] = 0;
+        pwm_write(function, false);
+    }
+    SREG = sreg;
+}
+
+uint8_t Pwm_get_level(Function_t function) {
+    if (function >= FUNCTION_COUNT) return 0;
+    return level[function];
+}
+
+// Step ISR: every channel switches on at phase 0 and off when the phase
+// reaches its on-time, so full duty never switches off
+ISR(TIMER2_COMP_vect) {
+    Load_isr_enter();
+    if (++phase < PWM_STEPS) {
+        for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+            if ((pwm_mask & (1 << f)) && on_steps[f] == phase) {
+                pwm_write(f, false);
+            }
+        }
+        return;
+    }
+
+    // New period: ramp each level toward its target and latch the on-time
+    phase = 0;
+    for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+        if (!(pwm_mask & (1 << f))) {
+            continue;
+        }
+        uint8_t t = target[f];
+        uint8_t l = level[f];
+        if (l < t) {
+            l = (t - l > PWM_RAMP_STEP) ? l + PWM_RAMP_STEP : t;
+        } else if (l > t) {
+            l = (l - t > PWM_RAMP_STEP) ? l - PWM_RAMP_STEP : t;
+        }
+        level[f] = l;
+        // Round up so any non-zero level gives at least one step
+        on_steps[f] = ((uint16_t)l * PWM_STEPS + 254) / 255;
+        pwm_write(f, on_steps[f] != 0);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef PWM_H
+#define PWM_H
+
+#include "common.h"
+#include "config.h"
+#include "can_lookup.h"
+
+void Pwm_init(uint16_t mask);
+void Pwm_set(Function_t function, uint8_t duty);
+uint8_t Pwm_get_level(Function_t function);
+
+#endif // PWM_H
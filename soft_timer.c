@@ -0,0 +1,148 @@
+#include "soft_timer.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static Soft_Timer_t *wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static volatile uint32_t wheel_time = 0;
+
+// Link a timer into the slot matching its distance from now.
+// Caller must hold interrupts off.
+static void timer_insert(Soft_Timer_t *timer) {
+    uint32_t delta = timer->expires - wheel_time;
+    uint8_t level = 0;
+    uint32_t slot_time = timer->expires;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1UL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    if (delta >= (1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+        // Beyond the wheel, park in the farthest slot and re-cascade
+        slot_time = wheel_time + ((uint32_t)SLOT_MASK << (TIMER_WHEEL_BITS * level));
+    }
+
+    Soft_Timer_t **head = &wheel[level][(slot_time >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+    timer->next = *head;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void timer_unlink(Soft_Timer_t *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Re-distribute one higher-level slot into the levels below it
+static void timer_cascade(uint8_t level, uint8_t slot) {
+    Soft_Timer_t *timer = wheel[level][slot];
+    wheel[level][slot] = NULL;
+
+    while (timer) {
+        Soft_Timer_t *next = timer->next;
+        timer_insert(timer);
+        timer = next;
+    }
+}
+
+void Timer_init(void) {
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint8_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel[level][slot] = NULL;
+        }
+    }
+    wheel_time = 0;
+}
+
+void Timer_setup(Soft_Timer_t *timer, Timer_Callback_t callback, void *arg) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->period = 0;
+    timer->callback = callback;
+    timer->arg = arg;
+}
+
+// O(1): (re)arm a timer, period_ms 0 makes it one-shot
+void Timer_arm(Soft_Timer_t *timer, uint32_t delay_ms, uint32_t period_ms) {
+    if (delay_ms == 0) delay_ms = 1;
+
+    uint8_t sreg = SREG;
+    cli();
+    if (timer->pprev) {
+        timer_unlink(timer);
+    }
+    timer->expires = wheel_time + delay_ms;
+    timer->period = period_ms;
+    timer_insert(timer);
+    SREG = sreg;
+}
+
+// O(1): safe to call on a timer that is not armed
+void Timer_cancel(Soft_Timer_t *timer) {
+    uint8_t sreg = SREG;
+    cli();
+    if (timer->pprev) {
+        timer_unlink(timer);
+    }
+    SREG = sreg;
+}
+
+bool Timer_is_armed(const Soft_Timer_t *timer) {
+    return timer->pprev != NULL;
+}
+
+// Milliseconds since Timer_init(), safe from interrupt context
+uint32_t Timer_now(void) {
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t now = wheel_time;
+    SREG = sreg;
+    return now;
+}
+
+// Called from the 1 ms timer interrupt, callbacks run in interrupt context
+void Timer_tick(void) {
+    uint32_t now = ++wheel_time;
+
+    // Cascade higher levels each time the level below wraps
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if ((now >> (TIMER_WHEEL_BITS * (level - 1))) & SLOT_MASK) {
+            break;
+        }
+        timer_cascade(level, (now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK);
+    }
+
+    // Move the slot to a local list head. Callbacks may cancel or re-arm
+    // any timer still waiting in it, unlinking works through pprev.
+    Soft_Timer_t **head = &wheel[0][now & SLOT_MASK];
+    Soft_Timer_t *expiring = *head;
+    *head = NULL;
+    if (expiring) {
+        expiring->pprev = &expiring;
+    }
+
+    while (expiring) {
+        Soft_Timer_t *timer = expiring;
+        timer_unlink(timer);
+
+        if (timer->expires != now) {
+            // Parked timer that still has time to go
+            timer_insert(timer);
+        } else {
+            if (timer->period) {
+                timer->expires += timer->period;
+                timer_insert(timer);
+            }
+            timer->callback(timer->arg);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SOFT_TIMER_H
+#define SOFT_TIMER_H
+
+#include <stddef.h>
+#include "common.h"
+
+// 4 levels of 16 slots at 1 ms resolution: 16 ms, 256 ms, 4.1 s, 65.5 s.
+// Longer delays are parked in the last level and re-cascaded.
+#define TIMER_WHEEL_BITS 4
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+typedef void (*Timer_Callback_t)(void *arg);
+
+// Storage is owned by the caller, typically a static in the user module
+typedef struct Soft_Timer {
+    struct Soft_Timer *next;
+    struct Soft_Timer **pprev;   // NULL when not armed
+    uint32_t expires;
+    uint32_t period;             // 0 = one-shot
+    Timer_Callback_t callback;
+    void *arg;
+} Soft_Timer_t;
+
+void Timer_init(void);
+void Timer_setup(Soft_Timer_t *timer, Timer_Callback_t callback, void *arg);
+void Timer_arm(Soft_Timer_t *timer, uint32_t delay_ms, uint32_t period_ms);
+void Timer_cancel(Soft_Timer_t *timer);
+bool Timer_is_armed(const Soft_Timer_t *timer);
+uint32_t Timer_now(void);
+void Timer_tick(void);
+
+#endif // SOFT_TIMER_H
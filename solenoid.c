@@ -4,24 +4,149 @@
 #include "error_handler.h"
 #include "led.h"
 #include "debug.h"
+#include "profiler.h"
+#include "board.h"
+#include "fault_inject.h"
+#include "soft_timer.h"
+#include "pwm.h"
+#include "capture.h"
+#include "coil_diag.h"
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
 
-static bool pin_states[FUNCTION_COUNT];
-static Output_Mode_t pin_modes[FUNCTION_COUNT];
+#define SOL_CASE_WRITE(name, port, bit) BOARD_CASE_WRITE(FUNCTION_##name, port, bit)
+#define SOL_PIN_HIGH(name, port, bit) | (PORT##port & (1 << (bit)))
+// Proportional coils are switched by the PWM ISR, not from the bitmap
+#define SOL_APPLY(name, port, bit) \
+    if (!(pwm_mask & (1 << FUNCTION_##name))) sol_write(FUNCTION_##name, (outputs >> FUNCTION_##name) & 1);
+
+_Static_assert(FUNCTION_COUNT == 2 * PAIR_COUNT && FUNCTION_COUNT <= 16,
+               "Output bitmap expects pairwise functions in 16 bits");
+
+/*
+ * Pair transitions, evaluated for all pairs at once on the output bitmap:
+ *
+ *   edge in a pair        momentary pair        latched pair
+ *   rise on one side      side on, partner off  side on, partner off
+ *   rise on both sides    both off              both off
+ *   fall                  side off              ignored
+ *
+ * Turn-ons beyond MAX_CONCURRENT_CHANNELS are refused, lowest function wins.
+ * A rise that reverses a pair (partner was on) releases the partner at once
+ * and holds the new side in `pending` until the pair's dead time expires.
+ */
+static uint16_t outputs = 0;           // Energized coils
+static uint16_t pending = 0;           // Waiting out a reversal dead time
+static uint16_t dead_time_mask = 0;    // Pairs with a non-zero dead time
+static uint8_t dead_time_ms[PAIR_COUNT];
+static volatile uint16_t expired = 0;  // Pairs whose dead time ran out
+static Soft_Timer_t dead_timers[PAIR_COUNT];
+static uint16_t pwm_mask = 0;          // Proportional functions
+static uint8_t duty[FUNCTION_COUNT];   // Last commanded duty per function
+
+// Constant function folds to a single sbi/cbi
+static inline void sol_write(Function_t function, bool on) {
+    switch (function) {
+        BOARD_SOLENOID_LIST(SOL_CASE_WRITE)
+        default: break;
+    }
+}
+
+static uint8_t sol_count(uint16_t bits) {
+    uint8_t count = 0;
+    while (bits) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+// Bitmap of the functions whose pair is latched
+static uint16_t sol_latch_mask(void) {
+    uint16_t mask = 0;
+    for (uint8_t pair = 0; pair < PAIR_COUNT; pair++) {
+        if (Mode_get_pair_mode((Pair_t)pair) == LATCH) {
+            mask |= BOARD_PAIR_MASK(pair);
+        }
+    }
+    return mask;
+}
+
+// Drop new turn-ons from the highest function down until the limit holds
+static uint16_t sol_limit(uint16_t next) {
+    uint16_t wanted = next;
+    uint16_t added = next & ~outputs;
+    uint8_t count = sol_count(next);
+
+    for (int8_t i = FUNCTION_COUNT - 1; i >= 0 && count > MAX_CONCURRENT_CHANNELS; i--) {
+        if (added & (1 << i)) {
+            next &= ~(1 << i);
+            count--;
+        }
+    }
+    if (next != wanted) {
+        DEBUG_PRINTLN("Max channels exceeded");
+    }
+    return next;
+}
+
+// Timer callback, ISR context: the main loop switches the coil on
+static void sol_dead_time_expired(void *arg) {
+    expired |= BOARD_PAIR_MASK((uint8_t)(uintptr_t)arg);
+}
+
+// Arm or cancel the dead-time timers of the pairs whose pending bits changed
+static void sol_update_pending(uint16_t next_pending) {
+    uint16_t started = next_pending & ~pending;
+    uint16_t cancelled = pending & ~next_pending;
+
+    // A stale expiry must not cut a new dead time short
+    cli();
+    expired &= ~started;
+    sei();
+
+    for (uint8_t pair = 0; pair < PAIR_COUNT; pair++) {
+        if (started & BOARD_PAIR_MASK(pair)) {
+            Timer_arm(&dead_timers[pair], dead_time_ms[pair], 0);
+        } else if (cancelled & BOARD_PAIR_MASK(pair)) {
+            Timer_cancel(&dead_timers[pair]);
+        }
+    }
+    pending = next_pending;
+}
+
+// Energized proportional coils get their commanded duty, the rest zero
+static void sol_apply_duties(void) {
+    for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+        if (pwm_mask & (1 << f)) {
+            Pwm_set((Function_t)f, ((outputs >> f) & 1) ? duty[f] : 0);
+        }
+    }
+}
 
 void Sol_init(void) {
-    // Initialize all GPIO pins as outputs
-    DDRA |= 0xFF; // PA0-PA7
-    DDRC |= 0x0F; // PC0-PC3
-    
-    // Initialize all pins to low
-    PORTA = 0x00;
-    PORTC &= 0xF0;
+    // Initialize all solenoid pins as outputs, low
+    BOARD_SOLENOID_LIST(BOARD_SET_OUTPUT)
+    BOARD_SOLENOID_LIST(BOARD_CLEAR)
     
-    // Initialize pin states and modes
-    for (uint8_t i = 0; i < FUNCTION_COUNT; i++) {
-        pin_states[i] = false;
-        pin_modes[i] = MOMENTARY; // Default, will be overridden by mode controller
+    outputs = 0;
+    pending = 0;
+    dead_time_mask = 0;
+    for (uint8_t pair = 0; pair < PAIR_COUNT; pair++) {
+        // Per-pair override in EEPROM, erased cells keep SOL_DEAD_TIME_MS
+        uint8_t ms = eeprom_read_byte((uint8_t*)(EEPROM_DEAD_TIME + pair));
+        dead_time_ms[pair] = (ms == 0xFF) ? SOL_DEAD_TIME_MS : ms;
+        if (dead_time_ms[pair] != 0) {
+            dead_time_mask |= BOARD_PAIR_MASK(pair);
+        }
+        Timer_setup(&dead_timers[pair], sol_dead_time_expired, (void *)(uintptr_t)pair);
+    }
+
+    pwm_mask = CAN_get_duty_mask();
+    for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+        duty[f] = 0;
     }
+    Pwm_init(pwm_mask);
 }
 
 Status_t Sol_set_pin_state(Function_t function, bool state) {
@@ -34,25 +159,24 @@ Status_t Sol_set_pin_state(Function_t function, bool state) {
         DEBUG_PRINTLN("Invalid function");
         return INVALID_PARAM;
     }
-    // Check current consumption limitations
+
+    uint16_t bit = (1 << function);
     if (state) {
-        uint8_t active_count = 0;
-        for (uint8_t i = 0; i < FUNCTION_COUNT; i++) {
-            if (pin_states[i]) active_count++;
-        }
-        
-        if (active_count >= MAX_CONCURRENT_CHANNELS) {
+        // Interlock: the partner goes off, then check the channel limit
+        uint16_t next = (outputs & ~BOARD_PAIR_PARTNERS(bit)) | bit;
+        if (sol_count(next) > MAX_CONCURRENT_CHANNELS) {
             DEBUG_PRINTLN("Max channels exceeded");
             return ERROR; // Too many active channels
         }
-        
-       // In a real system, we'd also check current sensor here
-        // Current sensor check would go here
-        DEBUG_PRINTLN("Current check passed");
+        outputs = next;
+        // A partner still waiting out its dead time must not come on later
+        sol_update_pending(pending & ~BOARD_PAIR_PARTNERS(bit));
+    } else {
+        // Also drop a turn-on still waiting out its dead time
+        outputs &= ~bit;
+        sol_update_pending(pending & ~bit);
     }
     
-    pin_states[function] = state;
-    
     // Toggle output LED
     LED_set(LED_OUTPUT, LED_BLINK, 100);
     DEBUG_PRINTLN("Output LED triggered");
@@ -62,36 +186,115 @@ Status_t Sol_set_pin_state(Function_t function, bool state) {
 
 bool Sol_read_pin_state(Function_t function) {
     if (function >= FUNCTION_COUNT) return false;
-    return pin_states[function];
+    return (outputs >> function) & 1;
+}
+
+// Rewrite every output from the bitmap. Also run periodically so a
+// disturbed PORT bit cannot persist.
+void Sol_commit_output(void) {
+    Coil_note_outputs(outputs);  // Baseline current before the pins change
+    BOARD_SOLENOID_LIST(SOL_APPLY)
+    sol_apply_duties();
+    Capture_note_outputs(outputs);
+    if (outputs == 0) {
+        Fault_note_safe();
+    }
 }
 
 void Sol_set_output(void) {
-    // Update all outputs based on pin_states
+    PROFILE_BEGIN(PROF_SOL_SET_OUTPUT);
+    // Update all outputs from the bitmap
     DEBUG_PRINTLN("Updating outputs");
-    uint8_t porta_state = 0;
-    uint8_t portc_state = PORTC & 0xF0; // Preserve upper nibble
-    
-    // PA0-PA7 mappings
-    if (pin_states[FUNCTION_C]) porta_state |= (1 << PA0);
-    if (pin_states[FUNCTION_D]) porta_state |= (1 << PA1);
-    if (pin_states[FUNCTION_E]) porta_state |= (1 << PA2);
-    if (pin_states[FUNCTION_F]) porta_state |= (1 << PA3);
-    if (pin_states[FUNCTION_G]) porta_state |= (1 << PA4);
-    if (pin_states[FUNCTION_H]) porta_state |= (1 << PA5);
-    if (pin_states[FUNCTION_M]) porta_state |= (1 << PA6);
-    if (pin_states[FUNCTION_N]) porta_state |= (1 << PA7);
-    
-    // PC0-PC3 mappings
-    if (pin_states[FUNCTION_A]) portc_state |= (1 << PC0);
-    if (pin_states[FUNCTION_P]) portc_state |= (1 << PC1);
-    if (pin_states[FUNCTION_J]) portc_state |= (1 << PC2);
-    if (pin_states[FUNCTION_L]) portc_state |= (1 << PC3);
-    
-    PORTA = porta_state;
-    PORTC = portc_state;
+    Sol_commit_output();
     DEBUG_PRINT("PORTA: ");
     DEBUG_PRINT_HEX(PORTA);
     DEBUG_PRINT(" PORTC: ");
     DEBUG_PRINT_HEX(PORTC);
     DEBUG_PRINTLN("");
+    PROFILE_END(PROF_SOL_SET_OUTPUT);
+}
+
+// Take the duty bytes of a command frame, before its edges are applied
+void Sol_update_duties(const uint8_t *data) {
+    if (pwm_mask == 0) {
+        return;
+    }
+    for (uint8_t f = 0; f < FUNCTION_COUNT; f++) {
+        if (pwm_mask & (1 << f)) {
+            duty[f] = CAN_decode_duty(data, (Function_t)f);
+        }
+    }
+    sol_apply_duties();
+}
+
+uint16_t Sol_get_output_bitmap(void) {
+    return outputs;
+}
+
+// Read back from the PORT registers. A PWM coil reads low between pulses,
+// so callers also need the bitmap empty.
+bool Sol_pins_off(void) {
+    return (0 BOARD_SOLENOID_LIST(SOL_PIN_HIGH)) == 0;
+}
+
+// Clear every output, pending reversal and expired dead time. Bitmap
+// only, Sol_set_output() writes the pins.
+void Sol_all_off(void) {
+    outputs = 0;
+    sol_update_pending(0);
+    cli();
+    expired = 0;
+    sei();
+}
+
+// Fail-safe: drop every output of a momentary pair, latched pairs keep their state
+void Sol_release_momentary(void) {
+    DEBUG_PRINTLN("Releasing momentary outputs");
+    uint16_t latch = sol_latch_mask();
+    outputs &= latch;
+    sol_update_pending(pending & latch);
+    Sol_set_output();
+    Fault_note_safe();
+}
+
+/**
+ * @brief Apply signal edges from the CAN decoder, see the transition table
+ * @return Rising bits refused by MAX_CONCURRENT_CHANNELS, still off
+ */
+uint16_t Sol_apply_edges(uint16_t rising, uint16_t falling) {
+    uint16_t current = outputs | pending;  // Pending coils count as on
+    uint16_t partners = BOARD_PAIR_PARTNERS(rising);
+    uint16_t turn_on = rising & ~partners;  // Both sides rising cancel out
+    uint16_t turn_off = partners | (falling & ~sol_latch_mask());
+    uint16_t next = sol_limit((current & ~turn_off) | turn_on);
+
+    // New coils whose energized partner is being released wait for the dead time
+    uint16_t reversing = next & ~current & BOARD_PAIR_PARTNERS(outputs & ~next) & dead_time_mask;
+
+    sol_update_pending((pending & next) | reversing);
+    next &= ~pending;
+    if (next != outputs) {
+        outputs = next;
+        LED_set(LED_OUTPUT, LED_BLINK, 100);
+    }
+    return turn_on & ~(outputs | pending);
+}
+
+// Switch on coils whose dead time has run out, true if the outputs changed
+bool Sol_service(void) {
+    uint16_t done;
+
+    cli();
+    done = expired;
+    expired = 0;
+    sei();
+
+    done &= pending;
+    if (done == 0) {
+        return false;
+    }
+    pending &= ~done;
+    outputs |= done;
+    Sol_set_output();
+    return true;
 }
@@ -9,5 +9,13 @@ void Sol_init(void);
 Status_t Sol_set_pin_state(Function_t function, bool state);
 bool Sol_read_pin_state(Function_t function);
 void Sol_set_output(void);
+void Sol_commit_output(void);
+void Sol_update_duties(const uint8_t *data);
+uint16_t Sol_get_output_bitmap(void);
+bool Sol_pins_off(void);
+void Sol_all_off(void);
+void Sol_release_momentary(void);
+uint16_t Sol_apply_edges(uint16_t rising, uint16_t falling);
+bool Sol_service(void);
 
 #endif // SOLENOID_H
\ No newline at end of file
@@ -13,147 +13,75 @@
 #include "error_handler.h"
 #include <avr/io.h>
 
-// Solenoid pin configuration
-typedef struct {
-    volatile uint8_t *port;
-    volatile uint8_t *ddr;
-    volatile uint8_t *pin_reg;
-    uint8_t pin;
-    bool state;
-    bool latched;
-    Channel_Pair_t pair;
-} Solenoid_Config_t;
+#define SOL_CASE_WRITE(name, port, bit) BOARD_CASE_WRITE(SOL_##name, port, bit)
 
-// Pin configurations
-static Solenoid_Config_t solenoid_config[SOL_COUNT];
+// Solenoid runtime state as bitmaps indexed by Solenoid_t, pairs are
+// adjacent bits (see BOARD_PAIR_MASK)
+static uint16_t state_mask = 0;    // Requested by the CAN signals
+static uint16_t latched_mask = 0;  // Held on in latch mode
+
+// Drive one solenoid, a constant pin folds to a single sbi/cbi
+static inline void sol_write(Solenoid_t pin, bool on)
+{
+    switch (pin) {
+        BOARD_SOLENOID_LIST(SOL_CASE_WRITE)
+        default: break;
+    }
+}
+
+#define SOL_APPLY(name, port, bit) sol_write(SOL_##name, (out >> SOL_##name) & 1);
+
+// Bitmap of the solenoids whose pair is in latch mode
+static uint16_t sol_latch_mask(void)
+{
+    uint16_t mask = 0;
+    for (uint8_t pair = 0; pair < PAIR_COUNT; pair++) {
+        if (Mode_GetPairMode((Channel_Pair_t)pair) == MODE_LATCH) {
+            mask |= BOARD_PAIR_MASK(pair);
+        }
+    }
+    return mask;
+}
+
+// Write every solenoid from a bitmap
+static void sol_write_all(uint16_t out)
+{
+    BOARD_SOLENOID_LIST(SOL_APPLY)
+}
 
 // Initialize solenoid control
 void Sol_Init(void)
 {
-    // Configure PORTA pins for solenoids C-H and M-N
-    // PA0 - C
-    solenoid_config[SOL_C].port = &PORTA;
-    solenoid_config[SOL_C].ddr = &DDRA;
-    solenoid_config[SOL_C].pin_reg = &PINA;
-    solenoid_config[SOL_C].pin = 0;
-    solenoid_config[SOL_C].pair = PAIR_1;
-    
-    // PA1 - D
-    solenoid_config[SOL_D].port = &PORTA;
-    solenoid_config[SOL_D].ddr = &DDRA;
-    solenoid_config[SOL_D].pin_reg = &PINA;
-    solenoid_config[SOL_D].pin = 1;
-    solenoid_config[SOL_D].pair = PAIR_1;
-    
-    // PA2 - E
-    solenoid_config[SOL_E].port = &PORTA;
-    solenoid_config[SOL_E].ddr = &DDRA;
-    solenoid_config[SOL_E].pin_reg = &PINA;
-    solenoid_config[SOL_E].pin = 2;
-    solenoid_config[SOL_E].pair = PAIR_2;
-    
-    // PA3 - F
-    solenoid_config[SOL_F].port = &PORTA;
-    solenoid_config[SOL_F].ddr = &DDRA;
-    solenoid_config[SOL_F].pin_reg = &PINA;
-    solenoid_config[SOL_F].pin = 3;
-    solenoid_config[SOL_F].pair = PAIR_2;
-    
-    // PA4 - G
-    solenoid_config[SOL_G].port = &PORTA;
-    solenoid_config[SOL_G].ddr = &DDRA;
-    solenoid_config[SOL_G].pin_reg = &PINA;
-    solenoid_config[SOL_G].pin = 4;
-    solenoid_config[SOL_G].pair = PAIR_3;
-    
-    // PA5 - H
-    solenoid_config[SOL_H].port = &PORTA;
-    solenoid_config[SOL_H].ddr = &DDRA;
-    solenoid_config[SOL_H].pin_reg = &PINA;
-    solenoid_config[SOL_H].pin = 5;
-    solenoid_config[SOL_H].pair = PAIR_3;
-    
-    // PA6 - M
-    solenoid_config[SOL_M].port = &PORTA;
-    solenoid_config[SOL_M].ddr = &DDRA;
-    solenoid_config[SOL_M].pin_reg = &PINA;
-    solenoid_config[SOL_M].pin = 6;
-    solenoid_config[SOL_M].pair = PAIR_4;
-    
-    // PA7 - N
-    solenoid_config[SOL_N].port = &PORTA;
-    solenoid_config[SOL_N].ddr = &DDRA;
-    solenoid_config[SOL_N].pin_reg = &PINA;
-    solenoid_config[SOL_N].pin = 7;
-    solenoid_config[SOL_N].pair = PAIR_4;
-    
-    // Configure PORTC pins for solenoids A, P, J, L
-    // PC0 - A
-    solenoid_config[SOL_A].port = &PORTC;
-    solenoid_config[SOL_A].ddr = &DDRC;
-    solenoid_config[SOL_A].pin_reg = &PINC;
-    solenoid_config[SOL_A].pin = 0;
-    solenoid_config[SOL_A].pair = PAIR_5;
-    
-    // PC1 - P
-    solenoid_config[SOL_P].port = &PORTC;
-    solenoid_config[SOL_P].ddr = &DDRC;
-    solenoid_config[SOL_P].pin_reg = &PINC;
-    solenoid_config[SOL_P].pin = 1;
-    solenoid_config[SOL_P].pair = PAIR_5;
-    
-    // PC2 - J
-    solenoid_config[SOL_J].port = &PORTC;
-    solenoid_config[SOL_J].ddr = &DDRC;
-    solenoid_config[SOL_J].pin_reg = &PINC;
-    solenoid_config[SOL_J].pin = 2;
-    solenoid_config[SOL_J].pair = PAIR_6;
-    
-    // PC3 - L
-    solenoid_config[SOL_L].port = &PORTC;
-    solenoid_config[SOL_L].ddr = &DDRC;
-    solenoid_config[SOL_L].pin_reg = &PINC;
-    solenoid_config[SOL_L].pin = 3;
-    solenoid_config[SOL_L].pair = PAIR_6;
-    
     // Set all pins as outputs and initialize to off
-    for (uint8_t i = 0; i < SOL_COUNT; i++) {
-        *(solenoid_config[i].ddr) |= (1 << solenoid_config[i].pin);
-        *(solenoid_config[i].port) &= ~(1 << solenoid_config[i].pin);
-        solenoid_config[i].state = false;
-        solenoid_config[i].latched = false;
-    }
+    BOARD_SOLENOID_LIST(BOARD_SET_OUTPUT)
+    BOARD_SOLENOID_LIST(BOARD_CLEAR)
+    
+    state_mask = 0;
+    latched_mask = 0;
 }
 
 // Set pin state
 void Sol_setPinState(Solenoid_t pin, bool state)
 {
     if (pin < SOL_COUNT) {
-        solenoid_config[pin].state = state;
+        uint16_t bit = (1 << pin);
+
+        if (state) {
+            state_mask |= bit;
+        } else {
+            state_mask &= ~bit;
+        }
         
-        // Check if pin is in latch mode
-        if (Mode_GetPairMode(solenoid_config[pin].pair) == MODE_LATCH) {
-            if (state) {
-                // In latch mode, remember the latched state
-                solenoid_config[pin].latched = true;
-                
-                // Find the paired pin and turn it off
-                for (uint8_t i = 0; i < SOL_COUNT; i++) {
-                    if (i != pin && solenoid_config[i].pair == solenoid_config[pin].pair) {
-                        solenoid_config[i].state = false;
-                        solenoid_config[i].latched = false;
-                        *(solenoid_config[i].port) &= ~(1 << solenoid_config[i].pin);
-                    }
-                }
-            }
+        // In latch mode, latch this pin and release its partner
+        if (state && (sol_latch_mask() & bit)) {
+            uint16_t partner = BOARD_PAIR_PARTNERS(bit);
+            latched_mask = (latched_mask & ~partner) | bit;
+            state_mask &= ~partner;
+            sol_write((Solenoid_t)(pin ^ 1), false);
         }
         
         // Apply the state to the pin
-        if (state) {
-            *(solenoid_config[pin].port) |= (1 << solenoid_config[pin].pin);
-        } else {
-            *(solenoid_config[pin].port) &= ~(1 << solenoid_config[pin].pin);
-        }
+        sol_write(pin, state);
         
         // Toggle output LED to indicate operation
         LED_Set(LED3_GREEN, BLINK, 100);
@@ -164,7 +92,7 @@ void Sol_setPinState(Solenoid_t pin, bool state)
 bool Sol_readPinState(Solenoid_t pin)
 {
     if (pin < SOL_COUNT) {
-        return solenoid_config[pin].state;
+        return (state_mask >> pin) & 1;
     }
     return false;
 }
@@ -172,35 +100,17 @@ bool Sol_readPinState(Solenoid_t pin)
 // Set output based on current states and modes
 void Sol_setOutput(void)
 {
-    // Update pins based on their states and modes
-    for (uint8_t i = 0; i < SOL_COUNT; i++) {
-        // For momentary mode, pin is active only when state is true
-        if (Mode_GetPairMode(solenoid_config[i].pair) == MODE_MOMENTARY) {
-            if (solenoid_config[i].state) {
-                *(solenoid_config[i].port) |= (1 << solenoid_config[i].pin);
-            } else {
-                *(solenoid_config[i].port) &= ~(1 << solenoid_config[i].pin);
-                solenoid_config[i].latched = false;
-            }
-        }
-        // For latch mode, pin stays active until its paired pin is activated
-        else if (Mode_GetPairMode(solenoid_config[i].pair) == MODE_LATCH) {
-            if (solenoid_config[i].latched) {
-                *(solenoid_config[i].port) |= (1 << solenoid_config[i].pin);
-            } else {
-                *(solenoid_config[i].port) &= ~(1 << solenoid_config[i].pin);
-            }
-        }
-    }
+    // Momentary pins follow their state, latched pins their latch
+    uint16_t latch = sol_latch_mask();
+    latched_mask &= latch;
+    sol_write_all((state_mask & ~latch) | latched_mask);
     
     // Check for overcurrent
     if (CurrentSensor_IsOverCurrent()) {
         // Turn off all outputs and log error
-        for (uint8_t i = 0; i < SOL_COUNT; i++) {
-            *(solenoid_config[i].port) &= ~(1 << solenoid_config[i].pin);
-            solenoid_config[i].state = false;
-            solenoid_config[i].latched = false;
-        }
+        state_mask = 0;
+        latched_mask = 0;
+        sol_write_all(0);
         
         Err_LogError(ERR_OVERCURRENT, 4); // 4 = Solenoid module
         Err_TriggerErrProtocol(ERR_OVERCURRENT);
@@ -210,21 +120,12 @@ void Sol_setOutput(void)
 // Update function to periodically check and apply solenoid states
 void Sol_Update(void)
 {
-    // Check if any latched solenoids need to be released
-    for (uint8_t i = 0; i < SOL_COUNT; i++) {
-        // For latch mode, check if paired control was activated
-        if (Mode_GetPairMode(solenoid_config[i].pair) == MODE_LATCH && solenoid_config[i].latched) {
-            // Find the paired pin
-            for (uint8_t j = 0; j < SOL_COUNT; j++) {
-                if (j != i && solenoid_config[j].pair == solenoid_config[i].pair) {
-                    // If the paired pin was activated, unlatch this pin
-                    if (solenoid_config[j].state) {
-                        solenoid_config[i].latched = false;
-                        *(solenoid_config[i].port) &= ~(1 << solenoid_config[i].pin);
-                    }
-                }
-            }
-        }
+    // A latched pin is released when its partner is requested
+    uint16_t released = latched_mask & BOARD_PAIR_PARTNERS(state_mask) & sol_latch_mask();
+    
+    if (released) {
+        latched_mask &= ~released;
+        sol_write_all((state_mask & ~sol_latch_mask()) | latched_mask);
     }
 }
 
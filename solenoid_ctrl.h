@@ -12,24 +12,18 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "mode_ctrl.h"
+#include "board.h"
 
-// Pin mapping for solenoids
+// Solenoid channels, pins are assigned in BOARD_SOLENOID_LIST
+#define SOL_ENUM(name, port, bit) SOL_##name,
 typedef enum {
-    SOL_C = 0,  // PA0
-    SOL_D = 1,  // PA1
-    SOL_E = 2,  // PA2
-    SOL_F = 3,  // PA3
-    SOL_G = 4,  // PA4
-    SOL_H = 5,  // PA5
-    SOL_M = 6,  // PA6
-    SOL_N = 7,  // PA7
-    SOL_A = 8,  // PC0
-    SOL_P = 9,  // PC1
-    SOL_J = 10, // PC2
-    SOL_L = 11, // PC3
+    BOARD_SOLENOID_LIST(SOL_ENUM)
     SOL_COUNT
 } Solenoid_t;
 
+// Solenoids are enumerated pairwise, C/D is PAIR_1 ... J/L is PAIR_6
+#define SOL_PAIR(pin) ((Channel_Pair_t)((pin) >> 1))
+
 // Function prototypes
 void Sol_Init(void);
 void Sol_setPinState(Solenoid_t pin, bool state);
@@ -0,0 +1,163 @@
+#include "stream.h"
+
+#if STREAM_ENABLED
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "adc_scan.h"
+#include "solenoid.h"
+#include "soft_timer.h"
+#include "cpu_load.h"
+
+/*
+ * Packet, little endian, COBS encoded and terminated by a zero byte:
+ *
+ *   0   version         6   first sweep (u16)   11  sweeps per packet
+ *   1   sequence        8   output bitmap       12  sweep period us (u16)
+ *   2   ms (u32)        10  inputs per sweep    14  samples (u16), sweep major
+ *   last  checksum, all bytes sum to zero
+ *
+ * The ADC ISR fills one of two staging buffers, the main loop encodes a
+ * full one into the TX ring and the UDRE interrupt drains the ring.
+ */
+#define STREAM_SAMPLES (STREAM_SWEEPS * SENSE_COUNT)
+#define STREAM_HEADER 14
+#define STREAM_PACKET (STREAM_HEADER + 2 * STREAM_SAMPLES + 1)
+#define STREAM_ENCODED (STREAM_PACKET + 2)  // One COBS block plus the delimiter
+#define STREAM_SWEEP_US (1000000UL * SENSE_COUNT / ADC_SCAN_RATE_HZ)
+#define STREAM_UBRR (F_CPU / 8 / STREAM_UART_BAUD - 1)  // Double speed
+
+_Static_assert(!DEBUG_ENABLED, "STREAM_ENABLED needs DEBUG_ENABLED 0");
+_Static_assert(F_CPU % (8 * STREAM_UART_BAUD) == 0, "STREAM_UART_BAUD has no exact divisor");
+_Static_assert(STREAM_PACKET <= 253, "Packet must fit one COBS block and the ring");
+_Static_assert((uint32_t)STREAM_ENCODED * 10 * ADC_SCAN_RATE_HZ / SENSE_COUNT / STREAM_SWEEPS <
+               STREAM_UART_BAUD, "Stream exceeds the UART bandwidth");
+
+// Staging, written by the ADC ISR
+static uint16_t stage[2][STREAM_SAMPLES];
+static uint32_t stage_ms[2];
+static uint16_t stage_sweep[2];
+static volatile bool stage_ready[2];
+static uint8_t fill = 0;
+static uint8_t pos = 0;
+static uint16_t sweep = 0;
+
+// TX ring, 256 bytes so the indices wrap by themselves
+static uint8_t tx[256];
+static volatile uint8_t tx_head = 0;  // Main loop
+static volatile uint8_t tx_tail = 0;  // UDRE ISR
+static uint8_t sequence = 0;
+
+void Stream_init(void) {
+    UBRR1H = (uint8_t)(STREAM_UBRR >> 8);
+    UBRR1L = (uint8_t)STREAM_UBRR;
+    UCSR1A = (1 << U2X1);
+    UCSR1C = (1 << UCSZ11) | (1 << UCSZ10);
+    UCSR1B = (1 << TXEN1);
+}
+
+// ADC ISR, every conversion. Packets start at input 0 of a sweep.
+void Stream_sample(uint8_t input, uint16_t value) {
+    if (pos == 0) {
+        if (input != 0) {
+            return;
+        }
+        stage_ms[fill] = Timer_now();
+        stage_sweep[fill] = sweep;
+    }
+    stage[fill][pos++] = value;
+    if (input != SENSE_COUNT - 1) {
+        return;
+    }
+    sweep++;
+    if (pos >= STREAM_SAMPLES) {
+        // The other buffer is still being encoded: drop this one, the
+        // host sees a gap in the first sweep field
+        if (!stage_ready[fill ^ 1]) {
+            stage_ready[fill] = true;
+            fill ^= 1;
+        }
+        pos = 0;
+    }
+}
+
+static void stream_encode(uint8_t b) {
+    uint8_t packet[STREAM_PACKET];
+    uint16_t outputs = Sol_get_output_bitmap();
+    uint8_t sum = 0;
+    uint8_t n = 0;
+
+    packet[n++] = STREAM_VERSION;
+    packet[n++] = sequence++;
+    for (uint8_t i = 0; i < 4; i++) {
+        packet[n++] = (uint8_t)(stage_ms[b] >> (8 * i));
+    }
+    packet[n++] = (uint8_t)stage_sweep[b];
+    packet[n++] = (uint8_t)(stage_sweep[b] >> 8);
+    packet[n++] = (uint8_t)outputs;
+    packet[n++] = (uint8_t)(outputs >> 8);
+    packet[n++] = SENSE_COUNT;
+    packet[n++] = STREAM_SWEEPS;
+    packet[n++] = (uint8_t)STREAM_SWEEP_US;
+    packet[n++] = (uint8_t)(STREAM_SWEEP_US >> 8);
+    for (uint8_t i = 0; i < STREAM_SAMPLES; i++) {
+        packet[n++] = (uint8_t)stage[b][i];
+        packet[n++] = (uint8_t)(stage[b][i] >> 8);
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        sum += packet[i];
+    }
+    packet[n++] = (uint8_t)-sum;
+
+    // COBS into the ring, published only once the frame is complete
+    uint8_t w = tx_head;
+    uint8_t code_at = w++;
+    uint8_t code = 1;
+    for (uint8_t i = 0; i < n; i++) {
+        if (packet[i] == 0) {
+            tx[code_at] = code;
+            code_at = w++;
+            code = 1;
+        } else {
+            tx[w++] = packet[i];
+            code++;
+        }
+    }
+    tx[code_at] = code;
+    tx[w++] = 0;
+
+    tx_head = w;
+    cli();
+    UCSR1B |= (1 << UDRIE1);
+    sei();
+}
+
+// Main loop, every pass: encode a staged packet if the ring has room
+void Stream_update(void) {
+    for (uint8_t b = 0; b < 2; b++) {
+        if (!stage_ready[b]) {
+            continue;
+        }
+        // Full ring: the packet is lost, the host sees a sequence and sweep gap
+        if ((uint8_t)(tx_head - tx_tail) < (uint8_t)(256 - STREAM_ENCODED)) {
+            stream_encode(b);
+        } else {
+            sequence++;
+        }
+        stage_ready[b] = false;
+    }
+}
+
+ISR(USART1_UDRE_vect) {
+    uint8_t tail = tx_tail;
+
+    Load_isr_enter();
+    if (tail == tx_head) {
+        UCSR1B &= ~(1 << UDRIE1);
+        return;
+    }
+    UDR1 = tx[tail];
+    tx_tail = tail + 1;
+}
+
+#endif // STREAM_ENABLED
@@ -0,0 +1,19 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "common.h"
+#include "config.h"
+
+#define STREAM_VERSION 1
+
+#if STREAM_ENABLED
+void Stream_init(void);
+void Stream_sample(uint8_t input, uint16_t value);
+void Stream_update(void);
+#else
+static inline void Stream_init(void) {}
+static inline void Stream_sample(uint8_t input, uint16_t value) { (void)input; (void)value; }
+static inline void Stream_update(void) {}
+#endif
+
+#endif // STREAM_H
@@ -0,0 +1,95 @@
+#include "supervisor.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/wdt.h>
+#include "soft_timer.h"
+#include "debug.h"
+
+// Longest gap between check-ins per Sup_Task_t
+static const uint16_t sup_window_ms[SUP_COUNT] = {
+    SUP_CAN_WINDOW_MS,
+    SUP_CURRENT_WINDOW_MS,
+};
+
+static volatile uint8_t checked_in[SUP_COUNT];
+static uint16_t age_ms[SUP_COUNT];
+static Soft_Timer_t check_timer;
+
+// Survive the watchdog reset, read back by Sup_init()
+static uint8_t reset_cause __attribute__((section(".noinit")));
+static uint8_t missed_tasks __attribute__((section(".noinit")));
+
+void Sup_save_reset_cause(void) __attribute__((naked, used, section(".init3")));
+
+/**
+ * @brief Latch and clear MCUSR before the C runtime starts. WDRF keeps the
+ *        watchdog running after a watchdog reset, it must be turned off
+ *        before the start-up code can outlast the timeout.
+ */
+void Sup_save_reset_cause(void)
+{
+    reset_cause = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+// Timer callback: feed the watchdog only while every activity is alive
+static void sup_check(void *arg) {
+    uint8_t missed = 0;
+    (void)arg;
+
+    for (uint8_t i = 0; i < SUP_COUNT; i++) {
+        if (checked_in[i]) {
+            checked_in[i] = 0;
+            age_ms[i] = 0;
+        } else if (age_ms[i] < sup_window_ms[i]) {
+            age_ms[i] += SUP_CHECK_PERIOD_MS;
+        }
+        if (age_ms[i] >= sup_window_ms[i]) {
+            missed |= (1 << i);
+        }
+    }
+
+    if (missed == 0) {
+        wdt_reset();
+    } else {
+        // Starve the watchdog, remember who hung for the post-mortem
+        missed_tasks = missed;
+    }
+}
+
+void Sup_init(void) {
+    if (reset_cause & (1 << WDRF)) {
+        uint16_t count = eeprom_read_word((uint16_t*)EEPROM_WDT_RESETS);
+        if (count == 0xFFFF) {
+            count = 0;
+        }
+        eeprom_update_word((uint16_t*)EEPROM_WDT_RESETS, count + 1);
+        eeprom_update_byte((uint8_t*)EEPROM_WDT_MISSED, missed_tasks);
+
+        DEBUG_PRINT("Watchdog reset, missed tasks: ");
+        DEBUG_PRINT_HEX(missed_tasks);
+        DEBUG_PRINTLN("");
+    }
+    eeprom_update_byte((uint8_t*)EEPROM_RESET_CAUSE, reset_cause);
+    missed_tasks = 0;
+
+    for (uint8_t i = 0; i < SUP_COUNT; i++) {
+        checked_in[i] = 0;
+        age_ms[i] = 0;
+    }
+
+    wdt_enable(WDT_TIMEOUT);
+    Timer_setup(&check_timer, sup_check, NULL);
+    Timer_arm(&check_timer, SUP_CHECK_PERIOD_MS, SUP_CHECK_PERIOD_MS);
+}
+
+// Single byte store, safe from any context
+void Sup_checkin(Sup_Task_t task) {
+    checked_in[task] = 1;
+}
+
+uint8_t Sup_get_reset_cause(void) {
+    return reset_cause;
+}
@@ -0,0 +1,18 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include "common.h"
+#include "config.h"
+
+// Activities that must check in for the watchdog to be fed
+typedef enum {
+    SUP_CAN = 0,      // Command processing
+    SUP_CURRENT,      // Current monitoring and the periodic output rewrite
+    SUP_COUNT
+} Sup_Task_t;
+
+void Sup_init(void);
+void Sup_checkin(Sup_Task_t task);
+uint8_t Sup_get_reset_cause(void);
+
+#endif // SUPERVISOR_H
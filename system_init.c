@@ -5,6 +5,9 @@
 #include "solenoid.h"
 #include "error_handler.h"
 #include "debug.h"
+#include "cmd_monitor.h"
+#include "current_cal.h"
+#include "coil_diag.h"
 
 void Sys_init_power(void) {
 
@@ -25,6 +28,7 @@ void Sys_init_power(void) {
 }
 
 void Sys_init_CAN(void) {
+    Cmd_monitor_init();
     CAN_init();
     
     DEBUG_PRINTLN("CAN initialized");
@@ -47,5 +51,7 @@ void Sys_init_monitor(void) {
     PORTF &= ~(1 << PF1); // No pull-up
     
     Err_init();
+    Cal_init();
+    Coil_init();
     DEBUG_PRINTLN("ADC initialized for signal on PF1 (ADC1)");
 }
@@ -1,6 +1,9 @@
 #include "system_timer.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "profiler.h"
+#include "soft_timer.h"
+#include "cpu_load.h"
 
 volatile static uint32_t system_ticks = 0;
 
@@ -20,11 +23,15 @@ void system_timer_init(void) {
     sei();
 }
 
-/* Timer1 compare match interrupt
+// Timer1 compare match interrupt
 ISR(TIMER1_COMPA_vect) {
+    Load_isr_enter();
+    PROFILE_BEGIN(PROF_ISR_TIMER);
     system_ticks++;
+    Timer_tick();
+    PROFILE_END(PROF_ISR_TIMER);
 }
-*/
+
 // Get current ticks in milliseconds
 uint32_t system_timer_get_ms(void) {
     uint32_t ticks;
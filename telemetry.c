@@ -0,0 +1,78 @@
+#include "telemetry.h"
+#include "can.h"
+#include "profiler.h"
+#include "mem_monitor.h"
+#include "cmd_monitor.h"
+#include "j1939.h"
+#include "can_error.h"
+#include "cpu_load.h"
+#include "event_log.h"
+#include "adc_scan.h"
+#include "coil_diag.h"
+
+static uint8_t current_page = 0;
+static uint8_t current_entry = 0;
+
+// Send one diagnostic frame per call, cycling through all pages
+void Telemetry_update(void) {
+    CAN_Message_t msg;
+    uint8_t entries = 1;
+
+    if (!J1939_is_claimed()) {
+        return;
+    }
+
+    msg.id = CAN_DIAG_ID_BASE | CAN_get_node_addr();
+    msg.length = 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        msg.data[i] = 0;
+    }
+    msg.data[0] = current_page;
+
+    switch (current_page) {
+        case TLM_PAGE_PROFILE:
+            Profile_fill_frame((Profile_Region_t)current_entry, &msg.data[1]);
+            entries = PROF_COUNT;
+            break;
+        case TLM_PAGE_MEMORY:
+            Mem_fill_frame(&msg.data[1]);
+            break;
+        case TLM_PAGE_CMD_MONITOR:
+            Cmd_fill_frame(current_entry, &msg.data[1]);
+            entries = CMD_TELEMETRY_ENTRIES;
+            break;
+        case TLM_PAGE_CAN_ERRORS:
+            CAN_error_fill_frame(current_entry, &msg.data[1]);
+            entries = CAN_ERROR_TELEMETRY_ENTRIES;
+            break;
+        case TLM_PAGE_CPU_LOAD:
+            Load_fill_frame(&msg.data[1]);
+            break;
+        case TLM_PAGE_EVENTS:
+            Event_fill_frame(current_entry, &msg.data[1]);
+            entries = EVENT_TELEMETRY_ENTRIES;
+            break;
+        case TLM_PAGE_CURRENT:
+            Adc_fill_frame(current_entry, &msg.data[1]);
+            entries = ADC_TELEMETRY_ENTRIES;
+            break;
+        case TLM_PAGE_COILS:
+            Coil_fill_frame(current_entry, &msg.data[1]);
+            entries = COIL_TELEMETRY_ENTRIES;
+            break;
+        default:
+            break;
+    }
+
+    // Retry the same entry next period if the TX MOb was busy
+    if (CAN_send(&msg) != SUCCESS) {
+        return;
+    }
+
+    if (++current_entry >= entries) {
+        current_entry = 0;
+        if (++current_page >= TLM_PAGE_COUNT) {
+            current_page = 0;
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "common.h"
+
+// Byte 0 of every diagnostic frame, byte 1.. is page specific
+typedef enum {
+    TLM_PAGE_PROFILE = 0,
+    TLM_PAGE_MEMORY,
+    TLM_PAGE_CMD_MONITOR,
+    TLM_PAGE_CAN_ERRORS,
+    TLM_PAGE_CPU_LOAD,
+    TLM_PAGE_EVENTS,
+    TLM_PAGE_CURRENT,
+    TLM_PAGE_COILS,
+    TLM_PAGE_COUNT
+} Telemetry_Page_t;
+
+void Telemetry_update(void);
+
+#endif // TELEMETRY_H
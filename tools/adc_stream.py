@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Record the binary ADC stream of a valve node as CSV.
+
+With STREAM_ENABLED 1 (and DEBUG_ENABLED 0) the node sends every sense
+input sample on the debug UART at STREAM_UART_BAUD, in COBS frames ended
+by a zero byte. Packet layout (little endian, see stream.c):
+
+    version u8, sequence u8, ms u32, first sweep u16, outputs u16,
+    inputs u8, sweeps u8, sweep period us u16, samples u16[sweeps][inputs],
+    checksum u8 (all bytes sum to zero)
+
+One CSV row is written per sweep:
+
+    adc_stream.py --port /dev/ttyUSB0 --out current.csv --duration 30
+
+Gaps in the sweep counter (packets dropped by the ADC ISR while the
+other staging buffer is still pending, or on a full TX ring) and bad
+frames are counted and reported at the end. The sequence number only
+advances for ring drops. Requires pyserial.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+
+STREAM_VERSION = 1
+STREAM_BAUD = 250000
+HEADER = struct.Struct("<BBIHHBBH")
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_packet(packet):
+    if len(packet) < HEADER.size + 1 or sum(packet) & 0xFF:
+        raise ValueError("bad length or checksum")
+    version, seq, ms, sweep, outputs, inputs, sweeps, period_us = HEADER.unpack_from(packet)
+    if version != STREAM_VERSION:
+        raise ValueError("unknown version %d" % version)
+    count = inputs * sweeps
+    if len(packet) != HEADER.size + 2 * count + 1:
+        raise ValueError("length does not match header")
+    samples = struct.unpack_from("<%dH" % count, packet, HEADER.size)
+    rows = []
+    for s in range(sweeps):
+        rows.append((seq, ms, (sweep + s) & 0xFFFF, s * period_us, outputs,
+                     samples[s * inputs:(s + 1) * inputs]))
+    return sweep, sweeps, inputs, rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", required=True, help="serial device, e.g. /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=STREAM_BAUD)
+    parser.add_argument("--out", default="-", help="CSV file, - for stdout")
+    parser.add_argument("--duration", type=float, default=0.0, help="seconds, 0 runs until Ctrl-C")
+    args = parser.parse_args()
+
+    import serial
+
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    out = sys.stdout if args.out == "-" else open(args.out, "w", newline="")
+    writer = csv.writer(out)
+    header_written = False
+    frame = bytearray()
+    synced = False      # The first frame may start mid-packet
+    next_sweep = None
+    packets = bad = lost = 0    # lost counts sweeps
+
+    start = time.monotonic()
+    try:
+        while not args.duration or time.monotonic() - start < args.duration:
+            for byte in port.read(4096):
+                if byte != 0:
+                    frame.append(byte)
+                    continue
+                if synced and frame:
+                    try:
+                        sweep, sweeps, inputs, rows = parse_packet(cobs_decode(frame))
+                    except ValueError:
+                        bad += 1
+                    else:
+                        packets += 1
+                        if next_sweep is not None:
+                            lost += (sweep - next_sweep) & 0xFFFF
+                        next_sweep = (sweep + sweeps) & 0xFFFF
+                        if not header_written:
+                            writer.writerow(["seq", "ms", "sweep", "offset_us", "outputs"] +
+                                            ["in%d" % i for i in range(inputs)])
+                            header_written = True
+                        for seq_, ms, sweep, offset, outputs, values in rows:
+                            writer.writerow([seq_, ms, sweep, offset, "0x%04X" % outputs] +
+                                            list(values))
+                synced = True
+                frame.clear()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        port.close()
+        if out is not sys.stdout:
+            out.close()
+
+    print("packets: %d  lost sweeps: %d  bad frames: %d" % (packets, lost, bad), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
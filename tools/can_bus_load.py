@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Bus-load scaling test for valve nodes sharing one CAN bus.
+
+Every node answers each command frame with a status frame on
+CAN_STATUS_ID_BASE | node address (see config.h). Byte 7 of the command is
+echoed back in status byte 0, so the sender can match replies, measure the
+command -> status latency per node and count missing replies.
+
+    can_bus_load.py --nodes 0x80-0x8F run --channel can0 --rate 20 --duration 60
+    can_bus_load.py --nodes 0x80-0x8F eeprom --out images/
+
+`eeprom` writes one Intel HEX EEPROM image per node (node address and command
+ID), ready for `avrdude -U eeprom:w:node_80.hex`.
+
+Requires python-can. Works against real nodes on a SocketCAN interface.
+"""
+
+import argparse
+import os
+import statistics
+import sys
+import time
+
+CAN_MSG_ID = 0x14FFFFB0
+CAN_STATUS_ID_BASE = 0x18FF5000
+
+# EEPROM layout, mirrors config.h / eeprom.h
+EEPROM_SIZE = 256
+EEPROM_CAN_BAUD = 0x00
+EEPROM_CAN_ID = 0x04
+EEPROM_MODE_PAIR1 = 0x08
+EEPROM_MODE_PAIR6 = 0x09
+MOMENTARY = 0
+EEPROM_NODE_ADDR = 0x10
+EEPROM_MAGIC_ADDR = 0xFF
+EEPROM_MAGIC_VALUE = 0xA5
+CAN_BAUD_INDEX = {125000: 0, 250000: 1, 500000: 2, 1000000: 3}
+REPLY_TIMEOUT = 0.5    # s, a command older than this counts as unanswered
+
+
+def parse_nodes(text):
+    nodes = []
+    for part in text.split(","):
+        if "-" in part:
+            lo, hi = (int(x, 0) for x in part.split("-"))
+            nodes.extend(range(lo, hi + 1))
+        else:
+            nodes.append(int(part, 0))
+    return nodes
+
+
+def frame_bits(dlc, extended=True):
+    """Nominal frame length including 3 bit interframe space, no stuffing."""
+    return (67 if extended else 47) + 8 * dlc
+
+
+def write_ihex(path, data):
+    with open(path, "w") as f:
+        for offset in range(0, len(data), 16):
+            chunk = data[offset:offset + 16]
+            record = [len(chunk), offset >> 8, offset & 0xFF, 0x00] + list(chunk)
+            checksum = (-sum(record)) & 0xFF
+            f.write(":" + "".join("%02X" % b for b in record) + "%02X\n" % checksum)
+        f.write(":00000001FF\n")
+
+
+def cmd_eeprom(args):
+    os.makedirs(args.out, exist_ok=True)
+    for addr in parse_nodes(args.nodes):
+        image = bytearray([0xFF] * EEPROM_SIZE)
+        image[EEPROM_CAN_BAUD] = CAN_BAUD_INDEX[args.bitrate]
+        image[EEPROM_CAN_ID:EEPROM_CAN_ID + 4] = args.cmd_id.to_bytes(4, "little")
+        image[EEPROM_MODE_PAIR1] = MOMENTARY
+        image[EEPROM_MODE_PAIR6] = MOMENTARY
+        image[EEPROM_NODE_ADDR] = addr
+        image[EEPROM_MAGIC_ADDR] = EEPROM_MAGIC_VALUE
+        path = os.path.join(args.out, "node_%02X.hex" % addr)
+        write_ihex(path, image)
+        print(path)
+
+
+def cmd_run(args):
+    import can
+
+    nodes = parse_nodes(args.nodes)
+    bus = can.interface.Bus(channel=args.channel, interface=args.interface)
+    period = 1.0 / args.rate
+    # sequence -> (send time, nodes yet to reply). Expired before the 8-bit
+    # sequence wraps, so a late reply is never matched to a newer command.
+    pending = {}
+    timeout = min(REPLY_TIMEOUT, 128 * period)
+    latency = {n: [] for n in nodes}
+    replies = {n: 0 for n in nodes}
+    node_dropped = {n: 0 for n in nodes}
+    bus_bits = 0
+    sent = 0
+    sequence = 0
+
+    start = time.monotonic()
+    next_tx = start
+    while time.monotonic() - start < args.duration:
+        now = time.monotonic()
+        if now >= next_tx:
+            data = bytearray(8)
+            data[7] = sequence
+            bus.send(can.Message(arbitration_id=args.cmd_id, data=data,
+                                 is_extended_id=True))
+            pending[sequence] = (now, set(nodes))
+            bus_bits += frame_bits(8)
+            sent += 1
+            sequence = (sequence + 1) & 0xFF
+            next_tx += period
+
+        for seq in [s for s, (t, _) in pending.items() if now - t > timeout]:
+            del pending[seq]
+
+        msg = bus.recv(timeout=max(0.0, next_tx - time.monotonic()))
+        if msg is None:
+            continue
+        bus_bits += frame_bits(msg.dlc, msg.is_extended_id)
+        node = msg.arbitration_id & 0xFF
+        if (msg.arbitration_id & ~0xFF) != CAN_STATUS_ID_BASE or node not in latency:
+            continue
+        entry = pending.get(msg.data[0])
+        if entry is not None and node in entry[1]:
+            latency[node].append(time.monotonic() - entry[0])
+            entry[1].discard(node)
+            if not entry[1]:
+                del pending[msg.data[0]]
+        replies[node] += 1
+        node_dropped[node] = msg.data[6] | (msg.data[7] << 8)
+
+    elapsed = time.monotonic() - start
+    bus.shutdown()
+
+    print("commands sent: %d in %.1f s (%.1f Hz)" % (sent, elapsed, sent / elapsed))
+    print("bus load: %.1f %% of %d bit/s" %
+          (100.0 * bus_bits / (elapsed * args.bitrate), args.bitrate))
+    print("node  replies  missed  dropped  lat_avg_ms  lat_max_ms")
+    for node in nodes:
+        samples = latency[node]
+        avg = statistics.mean(samples) * 1000 if samples else float("nan")
+        worst = max(samples) * 1000 if samples else float("nan")
+        print("0x%02X  %7d  %6d  %7d  %10.2f  %10.2f" %
+              (node, replies[node], sent - replies[node], node_dropped[node], avg, worst))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--nodes", default="0x80", help="node addresses, e.g. 0x80-0x8F,0x90")
+    parser.add_argument("--cmd-id", type=lambda x: int(x, 0), default=CAN_MSG_ID)
+    parser.add_argument("--bitrate", type=int, default=250000)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    run = sub.add_parser("run", help="drive the nodes and report latency and bus load")
+    run.add_argument("--channel", default="can0")
+    run.add_argument("--interface", default="socketcan")
+    run.add_argument("--rate", type=float, default=10.0, help="command frames per second")
+    run.add_argument("--duration", type=float, default=10.0, help="test length in seconds")
+    run.set_defaults(func=cmd_run)
+
+    eeprom = sub.add_parser("eeprom", help="write per-node EEPROM images")
+    eeprom.add_argument("--out", default=".")
+    eeprom.set_defaults(func=cmd_eeprom)
+
+    args = parser.parse_args()
+    args.func(args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())